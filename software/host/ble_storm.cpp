@@ -0,0 +1,455 @@
+/// @file ble_storm.cpp
+/// @brief replays scripted and random storms of gap events and gatt accesses against the
+/// firmware's ble handlers on the fake nimble host. reports events per second and handler
+/// latency, fails on exceptions escaping a handler and on unexpected results
+/// @copyright GPL v2.0
+
+// the gatt callbacks live in the anonymous namespace of main.cpp
+#include "main.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "fake/host.hpp"
+#include "mbedtls/sha256.h"
+
+namespace storm {
+
+struct Options {
+  /// repetitions of the scripted sequence
+  uint32_t rounds = 2000;
+  /// events of the random storm
+  uint32_t events = 200000;
+  uint32_t seed = 1;
+};
+
+/// @brief handling time and outcome of all events of one storm
+class Report {
+ public:
+  explicit Report(char const *_name) : name{_name}, start{std::chrono::steady_clock::now()} {}
+
+  /// @brief runs one event handler, timing it and catching what escapes it
+  /// @return result of the handler, -1 if it threw
+  template <typename Handler>
+  int handle(Handler &&handler) {
+    auto const begin = std::chrono::steady_clock::now();
+    int rc = -1;
+    try {
+      rc = handler();
+    } catch (std::exception const &e) {
+      fail("exception escaped handler", e.what());
+      ++exceptions;
+    } catch (...) {
+      fail("exception escaped handler", "unknown");
+      ++exceptions;
+    }
+    auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - begin)
+                        .count();
+    latency_ns.add(static_cast<uint32_t>(std::min<int64_t>(ns, UINT32_MAX)));
+    ++events;
+    return rc;
+  }
+
+  /// @brief records a result that differs from the expectation
+  void expect(std::string_view what, int rc, int expected) {
+    if (rc != expected) {
+      char detail[48];
+      std::snprintf(detail, sizeof(detail), "got %d, expected %d", rc, expected);
+      fail(what, detail);
+      ++unexpected;
+    }
+  }
+
+  void expect(std::string_view what, bool condition) { expect(what, condition, true); }
+
+  /// @brief prints the summary line
+  /// @return true if no handler threw and all results were as expected
+  bool print() const {
+    double const seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto const summary = latency_ns.summary();
+    std::printf(
+        "%s: %u events in %.1f ms, %.0f events/s, handler p50 %u ns p99 %u ns max %u ns, "
+        "%u exceptions, %u unexpected results\n",
+        name, events, seconds * 1e3, events / seconds, summary.p50_us, summary.p99_us,
+        summary.max_us, exceptions, unexpected);
+    return exceptions == 0 && unexpected == 0;
+  }
+
+ private:
+  void fail(std::string_view what, char const *detail) {
+    // the same failure repeats every round, the first few are enough to find it
+    if (exceptions + unexpected < 10) {
+      std::printf("%s: %.*s: %s\n", name, static_cast<int>(what.size()), what.data(), detail);
+    }
+  }
+
+  char const *name;
+  std::chrono::steady_clock::time_point start;
+  /// the histogram is unit agnostic, here it counts nanoseconds
+  trace::Histogram latency_ns;
+  uint32_t events = 0;
+  uint32_t exceptions = 0;
+  uint32_t unexpected = 0;
+};
+
+template <typename T>
+std::span<uint8_t const> bytes(T const &value) {
+  return {reinterpret_cast<uint8_t const *>(&value), sizeof(value)};
+}
+
+int gap(Report &report, ble_gap_event event) {
+  return report.handle([&] { return event_handler(&event, nullptr); });
+}
+
+int connect(Report &report, fake::Link const &link, int status = 0) {
+  if (status == 0) {
+    fake::connect(link);
+  }
+  ble_gap_event event = {.type = BLE_GAP_EVENT_CONNECT};
+  event.connect = {.status = status, .conn_handle = link.conn_handle};
+  return gap(report, event);
+}
+
+int disconnect(Report &report, uint16_t conn_handle) {
+  fake::disconnect(conn_handle);
+  ble_gap_event event = {.type = BLE_GAP_EVENT_DISCONNECT};
+  event.disconnect.reason = BLE_ERR_REM_USER_CONN_TERM;
+  event.disconnect.conn.conn_handle = conn_handle;
+  return gap(report, event);
+}
+
+int simple_gap(Report &report, uint8_t type, uint16_t conn_handle) {
+  ble_gap_event event = {.type = type};
+  switch (type) {
+    case BLE_GAP_EVENT_MTU:
+      event.mtu = {.conn_handle = conn_handle, .channel_id = 4, .value = 247};
+      break;
+    case BLE_GAP_EVENT_REPEAT_PAIRING:
+      event.repeat_pairing.conn_handle = conn_handle;
+      break;
+    case BLE_GAP_EVENT_ENC_CHANGE:
+      event.enc_change = {.status = 0, .conn_handle = conn_handle};
+      break;
+    default:
+      break;
+  }
+  return gap(report, event);
+}
+
+int write(Report &report, uint16_t conn_handle, uint16_t attr_handle,
+          std::span<uint8_t const> data) {
+  return report.handle([&] {
+    return fake::access(conn_handle, attr_handle, BLE_GATT_ACCESS_OP_WRITE_CHR, data);
+  });
+}
+
+int read(Report &report, uint16_t conn_handle, uint16_t attr_handle) {
+  return report.handle(
+      [&] { return fake::access(conn_handle, attr_handle, BLE_GATT_ACCESS_OP_READ_CHR, {}); });
+}
+
+ota::Hash sha256(std::span<uint8_t const> data) {
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, data.data(), data.size());
+  ota::Hash hash;
+  mbedtls_sha256_finish(&ctx, hash.data());
+  mbedtls_sha256_free(&ctx);
+  return hash;
+}
+
+/// @brief begin, chunks and end of a firmware update on one connection
+void ota_update(Report &report, uint16_t conn_handle, std::span<uint8_t const> image,
+                bool good_hash) {
+  constexpr size_t chunk_size = 32;
+  uint32_t const size = image.size();
+  std::array<uint8_t, 6> const begin = {0x01, static_cast<uint8_t>(size),
+                                        static_cast<uint8_t>(size >> 8),
+                                        static_cast<uint8_t>(size >> 16),
+                                        static_cast<uint8_t>(size >> 24), 2};
+  report.expect("ota begin on bonded link", write(report, conn_handle, ota_control_chr_val_handle,
+                                                  begin),
+                0);
+
+  for (uint16_t sequence = 0; sequence * chunk_size < size; ++sequence) {
+    std::array<uint8_t, 2 + chunk_size> chunk = {static_cast<uint8_t>(sequence),
+                                                 static_cast<uint8_t>(sequence >> 8)};
+    auto const payload = image.subspan(sequence * chunk_size,
+                                       std::min(chunk_size, size - sequence * chunk_size));
+    std::copy(payload.begin(), payload.end(), chunk.begin() + 2);
+    report.expect("ota chunk", write(report, conn_handle, ota_data_chr_val_handle,
+                                     std::span(chunk).first(2 + payload.size())),
+                  0);
+  }
+
+  std::array<uint8_t, 33> end = {0x02};
+  ota::Hash hash = sha256(image);
+  hash[0] ^= good_hash ? 0 : 1;
+  std::copy(hash.begin(), hash.end(), end.begin() + 1);
+  report.expect("ota end", write(report, conn_handle, ota_control_chr_val_handle, end), 0);
+  report.expect(good_hash ? "verified image pending" : "corrupt image not pending",
+                ota_updater.restart_pending() == good_hash);
+}
+
+/// @brief the same sequence of valid, malformed and failing accesses every round, each
+/// checked against the result the firmware has to give
+bool scripted_storm(Options const &options, drive::SpeedControl &speed_control) {
+  Report report("scripted storm");
+  auto const *const ble = ble_ptr.load(std::memory_order_acquire);
+  uint32_t const gap_events_before = ble->event_statistics().count;
+  report.expect("image confirmed once advertising",
+                fake::running_image_state == ESP_OTA_IMG_VALID);
+
+  drive::Parameters params;
+  params.pid = {.amp_i = 1, .amp_p = 2, .amp_d = 0, .limit_max = 1, .limit_min = -1};
+  params.pwm_period_ticks = 500;
+  params.wheel_circumpherance_m = 0.06f;
+  drive::Parameters invalid = params;
+  invalid.pid.limit_min = 2;
+  drive::Parameters beyond_full_duty = params;
+  beyond_full_duty.pid.limit_min = -5;
+  beyond_full_duty.pid.limit_max = 5;
+
+  std::vector<uint8_t> image(200);
+  std::iota(image.begin(), image.end(), uint8_t{3});
+
+  for (uint32_t round = 0; round < options.rounds; ++round) {
+    uint16_t const conn = 1 + round % 4;
+    fake::Link const plain = {.conn_handle = conn};
+    fake::Link const encrypted = {.conn_handle = conn, .encrypted = true};
+    fake::Link const bonded = {.conn_handle = conn, .encrypted = true, .bonded = true};
+
+    report.expect("connect", connect(report, plain), 0);
+    report.expect("bonding in the pairing window", ble_hs_cfg.sm_bonding == 1);
+    report.expect("mtu", simple_gap(report, BLE_GAP_EVENT_MTU, conn), 0);
+
+    report.expect("speed", write(report, conn, speed_chr_val_handle, bytes(0.3f)), 0);
+    speed_control.on_control_tick();
+    report.expect("position", write(report, conn, position_chr_val_handle, bytes(0.5f)), 0);
+    speed_control.on_control_tick();
+    report.expect("read position", read(report, conn, position_chr_val_handle), 0);
+    report.expect("read latency", read(report, conn, latency_chr_val_handle), 0);
+    report.expect("config", write(report, conn, config_chr_val_handle, bytes(params)), 0);
+
+    report.expect("short speed", write(report, conn, speed_chr_val_handle, bytes(params).first(3)),
+                  BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN);
+    report.expect("nan speed",
+                  write(report, conn, speed_chr_val_handle,
+                        bytes(std::numeric_limits<float>::quiet_NaN())),
+                  BLE_ATT_ERR_VALUE_NOT_ALLOWED);
+    report.expect("negative position",
+                  write(report, conn, position_chr_val_handle, bytes(-1.f)),
+                  BLE_ATT_ERR_VALUE_NOT_ALLOWED);
+    report.expect("invalid config", write(report, conn, config_chr_val_handle, bytes(invalid)),
+                  BLE_ATT_ERR_VALUE_NOT_ALLOWED);
+    report.expect("pid limits beyond full duty",
+                  write(report, conn, config_chr_val_handle, bytes(beyond_full_duty)),
+                  BLE_ATT_ERR_VALUE_NOT_ALLOWED);
+    report.expect("short config",
+                  write(report, conn, config_chr_val_handle, bytes(params).first(5)),
+                  BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN);
+    report.expect("led1 on", write(report, conn, led1_chr_val_handle, bytes(uint8_t{1})), 0);
+    report.expect("led2 off", write(report, conn, led2_chr_val_handle, bytes(uint8_t{0})), 0);
+    report.expect("long led1", write(report, conn, led1_chr_val_handle, bytes(uint16_t{1})),
+                  BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN);
+    report.expect("read speed", read(report, conn, speed_chr_val_handle),
+                  BLE_ATT_ERR_READ_NOT_PERMITTED);
+    report.expect("write latency", write(report, conn, latency_chr_val_handle, bytes(1.f)),
+                  BLE_ATT_ERR_WRITE_NOT_PERMITTED);
+
+    std::array<uint8_t, 6> const ota_begin = {0x01, 64, 0, 0, 0, 2};
+    report.expect("ota on plain link",
+                  write(report, conn, ota_control_chr_val_handle, ota_begin),
+                  BLE_ATT_ERR_INSUFFICIENT_ENC);
+    fake::connect(encrypted);
+    report.expect("encryption change", simple_gap(report, BLE_GAP_EVENT_ENC_CHANGE, conn), 0);
+    report.expect("ota without bond", write(report, conn, ota_control_chr_val_handle, ota_begin),
+                  BLE_ATT_ERR_INSUFFICIENT_AUTHEN);
+    fake::connect(bonded);
+    ota_update(report, conn, image, round % 2 == 0);
+
+    uint16_t const intruder = conn + 10;
+    fake::connect({.conn_handle = intruder, .encrypted = true, .bonded = true});
+    report.expect("ota chunk from other link",
+                  write(report, intruder, ota_data_chr_val_handle, bytes(uint32_t{0})),
+                  BLE_ATT_ERR_INSUFFICIENT_AUTHEN);
+    fake::disconnect(intruder);
+
+    report.expect("ota chunk after end",
+                  write(report, conn, ota_data_chr_val_handle, bytes(uint32_t{0})),
+                  BLE_ATT_ERR_INSUFFICIENT_AUTHEN);
+    report.expect("ota begin", write(report, conn, ota_control_chr_val_handle, ota_begin), 0);
+    report.expect("disconnect during transfer", disconnect(report, conn), 0);
+    report.expect("reconnect", connect(report, bonded), 0);
+    report.expect("ota chunk after reconnect",
+                  write(report, conn, ota_data_chr_val_handle, bytes(uint32_t{0})),
+                  BLE_ATT_ERR_INSUFFICIENT_AUTHEN);
+
+    report.expect("repeat pairing", simple_gap(report, BLE_GAP_EVENT_REPEAT_PAIRING, conn),
+                  BLE_GAP_REPEAT_PAIRING_RETRY);
+
+    fake::failures.mbuf_append = true;
+    report.expect("read position without buffer", read(report, conn, position_chr_val_handle),
+                  BLE_ATT_ERR_INSUFFICIENT_RES);
+    fake::failures = {};
+
+    fake::failures.conn_find = true;
+    report.expect("connect, link lost", connect(report, plain), BLE_HS_ENOTCONN);
+    fake::failures = {};
+    fake::failures.update_params = true;
+    report.expect("connect, parameter update refused", connect(report, plain), BLE_HS_ENOTCONN);
+    fake::failures = {};
+
+    report.expect("disconnect", disconnect(report, conn), 0);
+    report.expect("failed connect", connect(report, plain, BLE_HS_ENOTCONN), 0);
+    fake::failures.adv_start = true;
+    uint32_t const host_resets = fake::counters.host_resets;
+    report.expect("advertising complete, restart fails",
+                  simple_gap(report, BLE_GAP_EVENT_ADV_COMPLETE, conn), 0);
+    report.expect("host reset after failed advertising",
+                  fake::counters.host_resets == host_resets + 1);
+    fake::failures = {};
+    report.expect("subscribe", simple_gap(report, BLE_GAP_EVENT_SUBSCRIBE, conn), 0);
+    report.expect("unknown event", simple_gap(report, BLE_GAP_EVENT_UNKNOWN, conn), 0);
+  }
+
+  // every gap event but repeat pairing, which main answers itself, is timed by Ble
+  uint32_t const timed = ble->event_statistics().count - gap_events_before;
+  uint32_t const per_round = 12;
+  report.expect("gap events timed by ble", timed, options.rounds * per_round);
+
+  // past the pairing window links still encrypt, but no new bond is made
+  fake::advance_time_us(pairing_window_us);
+  report.expect("connect after the pairing window", connect(report, {.conn_handle = 1}), 0);
+  report.expect("no bonding after the pairing window", ble_hs_cfg.sm_bonding == 0);
+  report.expect("no repeat pairing after the pairing window",
+                simple_gap(report, BLE_GAP_EVENT_REPEAT_PAIRING, 1),
+                BLE_GAP_REPEAT_PAIRING_IGNORE);
+  report.expect("disconnect after the pairing window", disconnect(report, 1), 0);
+
+  return report.print();
+}
+
+/// @brief seeded random gap events and gatt accesses with random values and injected host
+/// failures. results are not predicted, but handlers must not throw and must answer with an
+/// att error code
+bool random_storm(Options const &options, drive::SpeedControl &speed_control) {
+  Report report("random storm");
+  std::mt19937 rng(options.seed);
+  auto chance = [&rng](uint32_t percent) { return rng() % 100 < percent; };
+
+  constexpr std::array<float, 9> floats = {
+      0.f, 0.2f, -0.5f, 3.f, 1e30f, -1e-40f, std::numeric_limits<float>::quiet_NaN(),
+      std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+  auto const &attributes = fake::attributes();
+  std::vector<uint8_t> payload;
+
+  for (uint32_t i = 0; i < options.events; ++i) {
+    fake::failures = {
+        .conn_find = chance(3),
+        .update_params = chance(3),
+        .ensure_addr = chance(3),
+        .adv_start = chance(3),
+        .mbuf_alloc = chance(3),
+        .mbuf_append = chance(3),
+        .notify = chance(3),
+    };
+    uint16_t const conn = rng() % 5;
+
+    uint32_t const kind = rng() % 100;
+    if (kind < 5) {
+      speed_control.on_control_tick();
+      if (auto *const lighting = lighting_ptr.load(std::memory_order_acquire)) {
+        lighting->set_speed_m_per_s(floats[rng() % floats.size()]);
+      }
+      // frame timer of the lighting, renders and hands frames to the refresh task
+      fake::fire_timers();
+    } else if (kind < 45) {
+      uint8_t const type = rng() % (BLE_GAP_EVENT_UNKNOWN + 2);
+      if (type == BLE_GAP_EVENT_CONNECT) {
+        connect(report, {.conn_handle = conn, .encrypted = chance(50), .bonded = chance(50)},
+                chance(80) ? 0 : BLE_HS_ENOTCONN);
+      } else if (type == BLE_GAP_EVENT_DISCONNECT) {
+        disconnect(report, conn);
+      } else {
+        simple_gap(report, type, conn);
+      }
+    } else {
+      auto const &attribute = attributes[rng() % attributes.size()];
+      constexpr std::array<size_t, 8> lengths = {0, 1, 2, 4, 6, 28, 33, 512};
+      payload.resize(chance(80) ? lengths[rng() % lengths.size()] : rng() % 600);
+      std::generate(payload.begin(), payload.end(), [&rng] { return rng(); });
+      if (payload.size() >= sizeof(float) && chance(50)) {
+        float const value = floats[rng() % floats.size()];
+        std::memcpy(payload.data(), &value, sizeof(value));
+      }
+      uint8_t const op = chance(90) ? rng() % 2 : rng() % 4;
+      int const rc = report.handle([&] {
+        return chance(80) ? fake::access(conn, attribute.handle, op, payload)
+                          : fake::access_unchecked(conn, attribute.handle, op, payload);
+      });
+      report.expect("att result in range", rc >= 0 && rc <= 0xff);
+    }
+  }
+  fake::failures = {};
+
+  return report.print();
+}
+
+bool run(Options const &options) {
+  drive::SpeedControl speed_control;
+  speed_control_ptr.store(&speed_control, std::memory_order_release);
+
+  bool const scripted = options.rounds == 0 || scripted_storm(options, speed_control);
+  bool const random = options.events == 0 || random_storm(options, speed_control);
+
+  speed_control_ptr.store(nullptr, std::memory_order_release);
+  return scripted && random;
+}
+
+}  // namespace storm
+
+int main(int argc, char **argv) {
+  storm::Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string_view const flag = argv[i];
+    uint32_t const value = std::strtoul(argv[i + 1], nullptr, 0);
+    if (flag == "--rounds") {
+      options.rounds = value;
+    } else if (flag == "--events") {
+      options.events = value;
+    } else if (flag == "--seed") {
+      options.seed = value;
+    } else if (flag == "--log-level") {
+      fake::log_level = static_cast<esp_log_level_t>(value);
+    } else {
+      std::printf("usage: %s [--rounds n] [--events n] [--seed n] [--log-level 0..5]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  bool ok = false;
+  fake::set_host_loop([&] {
+    try {
+      ok = storm::run(options);
+    } catch (std::exception const &e) {
+      std::printf("storm aborted: %s\n", e.what());
+    }
+  });
+
+  // like app_main before it creates the tasks
+  init_nvs();
+  // the real ble task: leds, ble stack and callbacks, then the host runs the storms
+  ble_nimble_task(nullptr);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
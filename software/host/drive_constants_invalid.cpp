@@ -0,0 +1,7 @@
+/// @file drive_constants_invalid.cpp
+/// @brief must not compile: DriveConstants rejects a drive without tacho pulses
+/// @copyright GPL v2.0
+
+#include "speed_ctrl.hpp"
+
+template struct drive::DriveConstants<0.06f, 0, 1'000'000, 500>;
@@ -0,0 +1,36 @@
+/// @file gptimer.h
+/// @brief host stand-in for the esp-idf general purpose timer, counts the host clock
+
+#pragma once
+
+#include "esp_err.h"
+
+typedef struct gptimer_t *gptimer_handle_t;
+
+typedef enum {
+  GPTIMER_CLK_SRC_DEFAULT,
+} gptimer_clock_source_t;
+
+typedef enum {
+  GPTIMER_COUNT_DOWN,
+  GPTIMER_COUNT_UP,
+} gptimer_count_direction_t;
+
+typedef struct {
+  gptimer_clock_source_t clk_src;
+  gptimer_count_direction_t direction;
+  uint32_t resolution_hz;
+  int intr_priority;
+  struct {
+    uint32_t intr_shared : 1;
+    uint32_t allow_pd : 1;
+  } flags;
+} gptimer_config_t;
+
+esp_err_t gptimer_new_timer(gptimer_config_t const *cfg, gptimer_handle_t *handle);
+esp_err_t gptimer_del_timer(gptimer_handle_t timer);
+esp_err_t gptimer_enable(gptimer_handle_t timer);
+esp_err_t gptimer_disable(gptimer_handle_t timer);
+esp_err_t gptimer_start(gptimer_handle_t timer);
+esp_err_t gptimer_stop(gptimer_handle_t timer);
+esp_err_t gptimer_get_raw_count(gptimer_handle_t timer, uint64_t *count);
@@ -0,0 +1,22 @@
+/// @file mcpwm_cmpr.h
+/// @brief host stand-in for the esp-idf mcpwm comparator
+
+#pragma once
+
+#include "driver/mcpwm_oper.h"
+
+typedef struct mcpwm_cmpr_t *mcpwm_cmpr_handle_t;
+
+typedef struct {
+  int intr_priority;
+  struct {
+    uint32_t update_cmp_on_tez : 1;
+    uint32_t update_cmp_on_tep : 1;
+    uint32_t update_cmp_on_sync : 1;
+  } flags;
+} mcpwm_comparator_config_t;
+
+esp_err_t mcpwm_new_comparator(mcpwm_oper_handle_t oper, mcpwm_comparator_config_t const *cfg,
+                               mcpwm_cmpr_handle_t *handle);
+esp_err_t mcpwm_del_comparator(mcpwm_cmpr_handle_t comparator);
+esp_err_t mcpwm_comparator_set_compare_value(mcpwm_cmpr_handle_t comparator, uint32_t compare);
@@ -0,0 +1,51 @@
+/// @file mcpwm_gen.h
+/// @brief host stand-in for the esp-idf mcpwm generator
+
+#pragma once
+
+#include "driver/mcpwm_cmpr.h"
+
+typedef struct mcpwm_gen_t *mcpwm_gen_handle_t;
+
+typedef enum {
+  MCPWM_GEN_ACTION_KEEP,
+  MCPWM_GEN_ACTION_LOW,
+  MCPWM_GEN_ACTION_HIGH,
+  MCPWM_GEN_ACTION_TOGGLE,
+} mcpwm_generator_action_t;
+
+typedef struct {
+  int gen_gpio_num;
+  struct {
+    uint32_t invert_pwm : 1;
+    uint32_t io_loop_back : 1;
+    uint32_t io_od_mode : 1;
+    uint32_t pull_up : 1;
+    uint32_t pull_down : 1;
+  } flags;
+} mcpwm_generator_config_t;
+
+typedef struct {
+  mcpwm_timer_direction_t direction;
+  mcpwm_timer_event_t event;
+  mcpwm_generator_action_t action;
+} mcpwm_gen_timer_event_action_t;
+
+typedef struct {
+  mcpwm_timer_direction_t direction;
+  mcpwm_cmpr_handle_t comparator;
+  mcpwm_generator_action_t action;
+} mcpwm_gen_compare_event_action_t;
+
+#define MCPWM_GEN_TIMER_EVENT_ACTION(dir, ev, act) \
+  (mcpwm_gen_timer_event_action_t{.direction = dir, .event = ev, .action = act})
+#define MCPWM_GEN_COMPARE_EVENT_ACTION(dir, cmp, act) \
+  (mcpwm_gen_compare_event_action_t{.direction = dir, .comparator = cmp, .action = act})
+
+esp_err_t mcpwm_new_generator(mcpwm_oper_handle_t oper, mcpwm_generator_config_t const *cfg,
+                              mcpwm_gen_handle_t *handle);
+esp_err_t mcpwm_del_generator(mcpwm_gen_handle_t generator);
+esp_err_t mcpwm_generator_set_action_on_timer_event(mcpwm_gen_handle_t generator,
+                                                    mcpwm_gen_timer_event_action_t action);
+esp_err_t mcpwm_generator_set_action_on_compare_event(mcpwm_gen_handle_t generator,
+                                                      mcpwm_gen_compare_event_action_t action);
@@ -0,0 +1,22 @@
+/// @file mcpwm_oper.h
+/// @brief host stand-in for the esp-idf mcpwm operator
+
+#pragma once
+
+#include "driver/mcpwm_timer.h"
+
+typedef struct mcpwm_oper_t *mcpwm_oper_handle_t;
+
+typedef struct {
+  int group_id;
+  int intr_priority;
+  struct {
+    uint32_t update_gen_action_on_tez : 1;
+    uint32_t update_gen_action_on_tep : 1;
+    uint32_t update_gen_action_on_sync : 1;
+  } flags;
+} mcpwm_operator_config_t;
+
+esp_err_t mcpwm_new_operator(mcpwm_operator_config_t const *cfg, mcpwm_oper_handle_t *handle);
+esp_err_t mcpwm_del_operator(mcpwm_oper_handle_t oper);
+esp_err_t mcpwm_operator_connect_timer(mcpwm_oper_handle_t oper, mcpwm_timer_handle_t timer);
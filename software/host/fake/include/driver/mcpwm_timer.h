@@ -0,0 +1,59 @@
+/// @file mcpwm_timer.h
+/// @brief host stand-in for the esp-idf mcpwm timer
+
+#pragma once
+
+#include "esp_err.h"
+
+typedef struct mcpwm_timer_t *mcpwm_timer_handle_t;
+
+typedef enum {
+  MCPWM_TIMER_CLK_SRC_DEFAULT,
+} mcpwm_timer_clock_source_t;
+
+typedef enum {
+  MCPWM_TIMER_COUNT_MODE_PAUSE,
+  MCPWM_TIMER_COUNT_MODE_UP,
+  MCPWM_TIMER_COUNT_MODE_DOWN,
+  MCPWM_TIMER_COUNT_MODE_UP_DOWN,
+} mcpwm_timer_count_mode_t;
+
+typedef enum {
+  MCPWM_TIMER_STOP_EMPTY,
+  MCPWM_TIMER_STOP_FULL,
+  MCPWM_TIMER_START_NO_STOP,
+  MCPWM_TIMER_START_STOP_EMPTY,
+  MCPWM_TIMER_START_STOP_FULL,
+} mcpwm_timer_start_stop_cmd_t;
+
+typedef enum {
+  MCPWM_TIMER_DIRECTION_UP,
+  MCPWM_TIMER_DIRECTION_DOWN,
+} mcpwm_timer_direction_t;
+
+typedef enum {
+  MCPWM_TIMER_EVENT_EMPTY,
+  MCPWM_TIMER_EVENT_FULL,
+  MCPWM_TIMER_EVENT_INVALID,
+} mcpwm_timer_event_t;
+
+typedef struct {
+  int group_id;
+  mcpwm_timer_clock_source_t clk_src;
+  uint32_t resolution_hz;
+  mcpwm_timer_count_mode_t count_mode;
+  uint32_t period_ticks;
+  int intr_priority;
+  struct {
+    uint32_t update_period_on_empty : 1;
+    uint32_t update_period_on_sync : 1;
+    uint32_t allow_pd : 1;
+  } flags;
+} mcpwm_timer_config_t;
+
+esp_err_t mcpwm_new_timer(mcpwm_timer_config_t const *cfg, mcpwm_timer_handle_t *handle);
+esp_err_t mcpwm_del_timer(mcpwm_timer_handle_t timer);
+esp_err_t mcpwm_timer_enable(mcpwm_timer_handle_t timer);
+esp_err_t mcpwm_timer_disable(mcpwm_timer_handle_t timer);
+esp_err_t mcpwm_timer_start_stop(mcpwm_timer_handle_t timer, mcpwm_timer_start_stop_cmd_t command);
+esp_err_t mcpwm_timer_set_period(mcpwm_timer_handle_t timer, uint32_t period_ticks);
@@ -0,0 +1,26 @@
+/// @file esp_err.h
+/// @brief host stand-in for esp-idf error codes
+/// @copyright GPL v2.0
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+using esp_err_t = int;
+
+constexpr esp_err_t ESP_OK = 0;
+constexpr esp_err_t ESP_FAIL = -1;
+constexpr esp_err_t ESP_ERR_NO_MEM = 0x101;
+constexpr esp_err_t ESP_ERR_INVALID_ARG = 0x102;
+constexpr esp_err_t ESP_ERR_INVALID_STATE = 0x103;
+constexpr esp_err_t ESP_ERR_NOT_FOUND = 0x105;
+constexpr esp_err_t ESP_ERR_NVS_NO_FREE_PAGES = 0x110d;
+constexpr esp_err_t ESP_ERR_NVS_NEW_VERSION_FOUND = 0x1110;
+
+#define ESP_ERROR_CHECK(x)   \
+  do {                       \
+    if ((x) != ESP_OK) {     \
+      std::abort();          \
+    }                        \
+  } while (0)
@@ -0,0 +1,17 @@
+/// @file esp_log.h
+/// @brief host stand-in for esp-idf logging. prints only up to fake::log_level
+
+#pragma once
+
+#include "esp_log_level.h"
+
+namespace fake {
+
+void log(esp_log_level_t level, char const *tag, char const *format, ...);
+
+}  // namespace fake
+
+#define ESP_LOGE(tag, format, ...) fake::log(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fake::log(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fake::log(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) fake::log(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
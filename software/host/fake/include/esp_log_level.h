@@ -0,0 +1,13 @@
+/// @file esp_log_level.h
+/// @brief host stand-in for esp-idf log levels
+
+#pragma once
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE,
+} esp_log_level_t;
@@ -0,0 +1,40 @@
+/// @file esp_ota_ops.h
+/// @brief host stand-in for esp-idf ota operations, the image goes nowhere
+
+#pragma once
+
+#include <cstddef>
+
+#include "esp_err.h"
+
+typedef uint32_t esp_ota_handle_t;
+
+typedef struct {
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+typedef enum {
+  ESP_OTA_IMG_NEW = 0x0,
+  ESP_OTA_IMG_PENDING_VERIFY = 0x1,
+  ESP_OTA_IMG_VALID = 0x2,
+  ESP_OTA_IMG_INVALID = 0x3,
+  ESP_OTA_IMG_ABORTED = 0x4,
+  ESP_OTA_IMG_UNDEFINED = 0xffffffff,
+} esp_ota_img_states_t;
+
+constexpr size_t OTA_SIZE_UNKNOWN = 0xffffffff;
+constexpr size_t OTA_WITH_SEQUENTIAL_WRITES = 0xfffffffe;
+
+esp_partition_t const *esp_ota_get_next_update_partition(esp_partition_t const *start_from);
+esp_err_t esp_ota_begin(esp_partition_t const *partition, size_t image_size,
+                        esp_ota_handle_t *handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, void const *data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(esp_partition_t const *partition);
+esp_partition_t const *esp_ota_get_running_partition();
+esp_err_t esp_ota_get_state_partition(esp_partition_t const *partition,
+                                      esp_ota_img_states_t *ota_state);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback();
@@ -0,0 +1,8 @@
+/// @file esp_system.h
+/// @brief host stand-in for esp-idf system functions
+
+#pragma once
+
+#include "esp_err.h"
+
+[[noreturn]] void esp_restart();
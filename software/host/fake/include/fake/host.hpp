@@ -0,0 +1,98 @@
+/// @file host.hpp
+/// @brief control surface of the fake esp-idf and nimble host for harnesses
+/// @copyright GPL v2.0
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "esp_log_level.h"
+#include "esp_ota_ops.h"
+#include "hal/gpio_types.h"
+#include "host/ble_gatt.h"
+
+namespace fake {
+
+/// messages above this level are dropped
+extern esp_log_level_t log_level;
+
+/// calls into the fake host that fail on purpose, for error path coverage
+struct Failures {
+  bool conn_find = false;
+  bool update_params = false;
+  bool ensure_addr = false;
+  bool adv_start = false;
+  bool mbuf_alloc = false;
+  bool mbuf_append = false;
+  bool notify = false;
+};
+
+extern Failures failures;
+
+/// @brief link to a peer as ble_gap_conn_find reports it
+struct Link {
+  uint16_t conn_handle;
+  bool encrypted = false;
+  bool bonded = false;
+};
+
+void connect(Link const &link);
+
+void disconnect(uint16_t conn_handle);
+
+/// characteristic registered by ble_gatts_add_svcs
+struct Attribute {
+  uint16_t handle;
+  ble_gatt_chr_def const *chr;
+};
+
+std::vector<Attribute> const &attributes();
+
+/// @return characteristic whose value handle is handle, nullptr if none
+Attribute const *find_attribute(uint16_t handle);
+
+/// @brief gatt access to the characteristic with value handle attr_handle. like nimble the
+/// flags of the characteristic and the link security are checked before the callback runs
+/// @param data written value, ignored for reads
+/// @return att result of the access
+int access(uint16_t conn_handle, uint16_t attr_handle, uint8_t op, std::span<uint8_t const> data);
+
+/// @brief like access but hands any op and value straight to the callback
+int access_unchecked(uint16_t conn_handle, uint16_t attr_handle, uint8_t op,
+                     std::span<uint8_t const> data);
+
+/// @brief fills om with data. the mbuf points into itself, so it is set up in place
+void init_mbuf(os_mbuf &om, std::span<uint8_t const> data);
+
+/// @brief loop nimble_port_run runs after the host synced, replaces the radio
+void set_host_loop(std::function<void()> loop);
+
+/// @brief runs the callbacks of all armed esp timers once
+void fire_timers();
+
+/// @brief moves esp_timer and gptimer time forward, on top of the host clock
+void advance_time_us(int64_t us);
+
+/// @brief runs the isr handler registered for gpio, like an edge on the pin
+void gpio_edge(gpio_num_t gpio);
+
+/// @return compare value last set on any mcpwm comparator
+uint32_t mcpwm_compare_value();
+
+struct Counters {
+  uint32_t advertising_starts = 0;
+  uint32_t notifications = 0;
+  uint32_t deleted_peers = 0;
+  uint32_t led_refreshes = 0;
+  uint32_t host_resets = 0;
+};
+
+extern Counters counters;
+
+/// state of the running image, a freshly updated one waits for the app to confirm it
+extern esp_ota_img_states_t running_image_state;
+
+}  // namespace fake
@@ -0,0 +1,25 @@
+/// @file FreeRTOS.h
+/// @brief host stand-in for the freertos types used by the firmware, 100 Hz tick like the target
+
+#pragma once
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+/// byte sized like on esp-idf, stack depths are given in bytes
+typedef uint8_t StackType_t;
+
+typedef struct {
+  uint8_t opaque[352];
+} StaticTask_t;
+
+constexpr TickType_t configTICK_RATE_HZ = 100;
+constexpr TickType_t portMAX_DELAY = UINT32_MAX;
+constexpr BaseType_t pdPASS = 1;
+constexpr BaseType_t pdTRUE = 1;
+constexpr BaseType_t pdFALSE = 0;
+
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>((ms) * configTICK_RATE_HZ / 1000))
+#define pdTICKS_TO_MS(ticks) (static_cast<TickType_t>((ticks) * 1000 / configTICK_RATE_HZ))
@@ -0,0 +1,17 @@
+/// @file semphr.h
+/// @brief host stand-in for freertos mutexes. the harness runs on one thread, takes always succeed
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct QueueDefinition *SemaphoreHandle_t;
+
+typedef struct {
+  uint8_t opaque[80];
+} StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
@@ -0,0 +1,23 @@
+/// @file task.h
+/// @brief host stand-in for freertos tasks. tasks are not started, the harness calls task
+/// functions itself. delays return at once
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t task, char const *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *handle);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t task, char const *name, uint32_t stack_depth,
+                               void *param, UBaseType_t priority, StackType_t *stack,
+                               StaticTask_t *buffer);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t period);
+TickType_t xTaskGetTickCount();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
@@ -0,0 +1,166 @@
+/// @file ble_gap.h
+/// @brief host stand-in for the nimble gap api
+
+#pragma once
+
+#include <cstdint>
+
+#include "nimble/ble.h"
+
+enum {
+  BLE_GAP_EVENT_CONNECT = 0,
+  BLE_GAP_EVENT_DISCONNECT = 1,
+  BLE_GAP_EVENT_CONN_UPDATE = 3,
+  BLE_GAP_EVENT_CONN_UPDATE_REQ = 4,
+  BLE_GAP_EVENT_L2CAP_UPDATE_REQ = 5,
+  BLE_GAP_EVENT_TERM_FAILURE = 6,
+  BLE_GAP_EVENT_DISC = 7,
+  BLE_GAP_EVENT_DISC_COMPLETE = 8,
+  BLE_GAP_EVENT_ADV_COMPLETE = 9,
+  BLE_GAP_EVENT_ENC_CHANGE = 10,
+  BLE_GAP_EVENT_PASSKEY_ACTION = 11,
+  BLE_GAP_EVENT_NOTIFY_RX = 12,
+  BLE_GAP_EVENT_NOTIFY_TX = 13,
+  BLE_GAP_EVENT_SUBSCRIBE = 14,
+  BLE_GAP_EVENT_MTU = 15,
+  BLE_GAP_EVENT_IDENTITY_RESOLVED = 16,
+  BLE_GAP_EVENT_REPEAT_PAIRING = 17,
+  BLE_GAP_EVENT_PHY_UPDATE_COMPLETE = 18,
+  /// first type not known to the fake
+  BLE_GAP_EVENT_UNKNOWN = 19,
+};
+
+constexpr int BLE_GAP_REPEAT_PAIRING_IGNORE = 0;
+constexpr int BLE_GAP_REPEAT_PAIRING_RETRY = 1;
+
+constexpr uint8_t BLE_GAP_CONN_MODE_NON = 0;
+constexpr uint8_t BLE_GAP_CONN_MODE_DIR = 1;
+constexpr uint8_t BLE_GAP_CONN_MODE_UND = 2;
+constexpr uint8_t BLE_GAP_DISC_MODE_NON = 0;
+constexpr uint8_t BLE_GAP_DISC_MODE_LTD = 1;
+constexpr uint8_t BLE_GAP_DISC_MODE_GEN = 2;
+
+#define BLE_GAP_ADV_ITVL_MS(t) ((t) * 1000 / 625)
+
+constexpr uint8_t BLE_HS_ADV_F_DISC_LTD = 0x01;
+constexpr uint8_t BLE_HS_ADV_F_DISC_GEN = 0x02;
+constexpr uint8_t BLE_HS_ADV_F_BREDR_UNSUP = 0x04;
+constexpr int8_t BLE_HS_ADV_TX_PWR_LVL_AUTO = -128;
+
+struct ble_gap_sec_state {
+  unsigned encrypted : 1;
+  unsigned authenticated : 1;
+  unsigned bonded : 1;
+  unsigned key_size : 5;
+};
+
+struct ble_gap_conn_desc {
+  ble_gap_sec_state sec_state;
+  ble_addr_t our_id_addr;
+  ble_addr_t peer_id_addr;
+  ble_addr_t our_ota_addr;
+  ble_addr_t peer_ota_addr;
+  uint16_t conn_handle;
+  uint16_t conn_itvl;
+  uint16_t conn_latency;
+  uint16_t supervision_timeout;
+  uint8_t role;
+  uint8_t master_clock_accuracy;
+};
+
+struct ble_gap_upd_params {
+  uint16_t itvl_min;
+  uint16_t itvl_max;
+  uint16_t latency;
+  uint16_t supervision_timeout;
+  uint16_t min_ce_len;
+  uint16_t max_ce_len;
+};
+
+struct ble_gap_adv_params {
+  uint8_t conn_mode;
+  uint8_t disc_mode;
+  uint16_t itvl_min;
+  uint16_t itvl_max;
+  uint8_t channel_map;
+  uint8_t filter_policy;
+  uint8_t high_duty_cycle : 1;
+};
+
+struct ble_gap_repeat_pairing {
+  uint16_t conn_handle;
+  uint8_t cur_key_size;
+  uint8_t cur_authenticated : 1;
+  uint8_t cur_sc : 1;
+  uint8_t new_key_size;
+  uint8_t new_authenticated : 1;
+  uint8_t new_sc : 1;
+  uint8_t new_bonding : 1;
+};
+
+struct ble_gap_event {
+  uint8_t type;
+  union {
+    struct {
+      int status;
+      uint16_t conn_handle;
+    } connect;
+    struct {
+      int reason;
+      ble_gap_conn_desc conn;
+    } disconnect;
+    struct {
+      int reason;
+    } adv_complete;
+    struct {
+      int status;
+      uint16_t conn_handle;
+    } enc_change;
+    struct {
+      uint16_t conn_handle;
+      uint16_t attr_handle;
+      uint8_t reason;
+      uint8_t prev_notify : 1;
+      uint8_t cur_notify : 1;
+      uint8_t prev_indicate : 1;
+      uint8_t cur_indicate : 1;
+    } subscribe;
+    struct {
+      uint16_t conn_handle;
+      uint16_t channel_id;
+      uint16_t value;
+    } mtu;
+    ble_gap_repeat_pairing repeat_pairing;
+  };
+};
+
+typedef int ble_gap_event_fn(ble_gap_event *event, void *arg);
+
+struct ble_hs_adv_fields {
+  uint8_t flags;
+  uint8_t const *name;
+  uint8_t name_len;
+  unsigned name_is_complete : 1;
+  int8_t tx_pwr_lvl;
+  unsigned tx_pwr_lvl_is_present : 1;
+  uint16_t appearance;
+  unsigned appearance_is_present : 1;
+  uint16_t adv_itvl;
+  unsigned adv_itvl_is_present : 1;
+  uint8_t const *device_addr;
+  uint8_t device_addr_type;
+  unsigned device_addr_is_present : 1;
+  uint8_t const *uri;
+  uint8_t uri_len;
+  uint8_t le_role;
+  unsigned le_role_is_present : 1;
+};
+
+int ble_gap_conn_find(uint16_t handle, ble_gap_conn_desc *out_desc);
+int ble_gap_update_params(uint16_t conn_handle, ble_gap_upd_params const *params);
+int ble_gap_adv_set_fields(ble_hs_adv_fields const *fields);
+int ble_gap_adv_rsp_set_fields(ble_hs_adv_fields const *fields);
+int ble_gap_adv_start(uint8_t own_addr_type, ble_addr_t const *direct_addr, int32_t duration_ms,
+                      ble_gap_adv_params const *params, ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_adv_stop();
+int ble_gap_adv_active();
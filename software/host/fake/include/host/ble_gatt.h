@@ -0,0 +1,79 @@
+/// @file ble_gatt.h
+/// @brief host stand-in for the nimble gatt server api
+
+#pragma once
+
+#include <cstdint>
+
+#include "host/ble_uuid.h"
+#include "os/os_mbuf.h"
+
+constexpr uint8_t BLE_GATT_ACCESS_OP_READ_CHR = 0;
+constexpr uint8_t BLE_GATT_ACCESS_OP_WRITE_CHR = 1;
+constexpr uint8_t BLE_GATT_ACCESS_OP_READ_DSC = 2;
+constexpr uint8_t BLE_GATT_ACCESS_OP_WRITE_DSC = 3;
+
+constexpr uint8_t BLE_GATT_SVC_TYPE_END = 0;
+constexpr uint8_t BLE_GATT_SVC_TYPE_PRIMARY = 1;
+constexpr uint8_t BLE_GATT_SVC_TYPE_SECONDARY = 2;
+
+typedef uint16_t ble_gatt_chr_flags;
+
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_BROADCAST = 0x0001;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_READ = 0x0002;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_WRITE_NO_RSP = 0x0004;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_WRITE = 0x0008;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_NOTIFY = 0x0010;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_INDICATE = 0x0020;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_READ_ENC = 0x0200;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_READ_AUTHEN = 0x0400;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_WRITE_ENC = 0x1000;
+constexpr ble_gatt_chr_flags BLE_GATT_CHR_F_WRITE_AUTHEN = 0x2000;
+
+struct ble_gatt_chr_def;
+struct ble_gatt_dsc_def;
+
+struct ble_gatt_access_ctxt {
+  uint8_t op;
+  os_mbuf *om;
+  union {
+    ble_gatt_chr_def const *chr;
+    ble_gatt_dsc_def const *dsc;
+  };
+};
+
+typedef int ble_gatt_access_fn(uint16_t conn_handle, uint16_t attr_handle,
+                               ble_gatt_access_ctxt *ctxt, void *arg);
+
+struct ble_gatt_dsc_def {
+  ble_uuid_t const *uuid;
+  uint8_t att_flags;
+  uint8_t min_key_size;
+  ble_gatt_access_fn *access_cb;
+  void *arg;
+};
+
+struct ble_gatt_chr_def {
+  ble_uuid_t const *uuid;
+  ble_gatt_access_fn *access_cb;
+  void *arg;
+  ble_gatt_dsc_def *descriptors;
+  ble_gatt_chr_flags flags;
+  uint8_t min_key_size;
+  uint16_t *val_handle;
+};
+
+struct ble_gatt_svc_def {
+  uint8_t type;
+  ble_uuid_t const *uuid;
+  ble_gatt_svc_def const **includes;
+  ble_gatt_chr_def const *characteristics;
+};
+
+struct ble_gatt_register_ctxt {
+  uint8_t op;
+};
+
+int ble_gatts_count_cfg(ble_gatt_svc_def const *services);
+int ble_gatts_add_svcs(ble_gatt_svc_def const *services);
+int ble_gatts_notify_custom(uint16_t conn_handle, uint16_t chr_val_handle, os_mbuf *om);
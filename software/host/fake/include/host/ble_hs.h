@@ -0,0 +1,76 @@
+/// @file ble_hs.h
+/// @brief host stand-in for the nimble host api the firmware uses
+
+#pragma once
+
+#include <cstdint>
+
+#include "host/ble_gap.h"
+#include "host/ble_gatt.h"
+#include "host/ble_hs_id.h"
+#include "host/ble_store.h"
+#include "host/ble_uuid.h"
+#include "nimble/hci_common.h"
+#include "os/os_mbuf.h"
+
+constexpr uint16_t BLE_HS_CONN_HANDLE_NONE = 0xffff;
+constexpr int32_t BLE_HS_FOREVER = INT32_MAX;
+
+constexpr int BLE_HS_EAGAIN = 1;
+constexpr int BLE_HS_EALREADY = 2;
+constexpr int BLE_HS_EINVAL = 3;
+constexpr int BLE_HS_EMSGSIZE = 4;
+constexpr int BLE_HS_ENOENT = 5;
+constexpr int BLE_HS_ENOMEM = 6;
+constexpr int BLE_HS_ENOTCONN = 7;
+constexpr int BLE_HS_ENOTSUP = 8;
+constexpr int BLE_HS_EUNKNOWN = 17;
+
+constexpr int BLE_ATT_ERR_INVALID_HANDLE = 0x01;
+constexpr int BLE_ATT_ERR_READ_NOT_PERMITTED = 0x02;
+constexpr int BLE_ATT_ERR_WRITE_NOT_PERMITTED = 0x03;
+constexpr int BLE_ATT_ERR_INVALID_PDU = 0x04;
+constexpr int BLE_ATT_ERR_INSUFFICIENT_AUTHEN = 0x05;
+constexpr int BLE_ATT_ERR_REQ_NOT_SUPPORTED = 0x06;
+constexpr int BLE_ATT_ERR_INVALID_OFFSET = 0x07;
+constexpr int BLE_ATT_ERR_INSUFFICIENT_AUTHOR = 0x08;
+constexpr int BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN = 0x0d;
+constexpr int BLE_ATT_ERR_UNLIKELY = 0x0e;
+constexpr int BLE_ATT_ERR_INSUFFICIENT_ENC = 0x0f;
+constexpr int BLE_ATT_ERR_INSUFFICIENT_RES = 0x11;
+constexpr int BLE_ATT_ERR_VALUE_NOT_ALLOWED = 0x13;
+
+constexpr uint8_t BLE_SM_IO_CAP_DISP_ONLY = 0;
+constexpr uint8_t BLE_SM_IO_CAP_DISP_YES_NO = 1;
+constexpr uint8_t BLE_SM_IO_CAP_KEYBOARD_ONLY = 2;
+constexpr uint8_t BLE_SM_IO_CAP_NO_IO = 3;
+constexpr uint8_t BLE_SM_PAIR_KEY_DIST_ENC = 0x01;
+constexpr uint8_t BLE_SM_PAIR_KEY_DIST_ID = 0x02;
+
+typedef void ble_hs_reset_fn(int reason);
+typedef void ble_hs_sync_fn();
+typedef void ble_gatt_register_fn(ble_gatt_register_ctxt *ctxt, void *arg);
+typedef int ble_store_status_fn(ble_store_status_event *event, void *arg);
+
+struct ble_hs_cfg_t {
+  ble_hs_reset_fn *reset_cb;
+  ble_hs_sync_fn *sync_cb;
+  ble_gatt_register_fn *gatts_register_cb;
+  void *gatts_register_arg;
+  ble_store_status_fn *store_status_cb;
+  void *store_status_arg;
+  uint8_t sm_io_cap;
+  unsigned sm_oob_data_flag : 1;
+  unsigned sm_bonding : 1;
+  unsigned sm_mitm : 1;
+  unsigned sm_sc : 1;
+  unsigned sm_keypress : 1;
+  uint8_t sm_our_key_dist;
+  uint8_t sm_their_key_dist;
+};
+
+extern ble_hs_cfg_t ble_hs_cfg;
+
+int ble_hs_mbuf_to_flat(os_mbuf const *om, void *flat, uint16_t max_len, uint16_t *out_copy_len);
+os_mbuf *ble_hs_mbuf_from_flat(void const *buf, uint16_t len);
+void ble_hs_sched_reset(int reason);
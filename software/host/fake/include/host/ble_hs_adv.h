@@ -0,0 +1,7 @@
+/// @file ble_hs_adv.h
+/// @brief host stand-in for the nimble advertising data limits
+
+#pragma once
+
+/// legacy advertising pdu payload
+#define BLE_HS_ADV_MAX_SZ 31
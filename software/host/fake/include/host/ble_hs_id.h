@@ -0,0 +1,9 @@
+/// @file ble_hs_id.h
+/// @brief host stand-in for nimble identity addresses
+
+#pragma once
+
+#include <cstdint>
+
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type);
+int ble_hs_id_copy_addr(uint8_t addr_type, uint8_t *out_id_addr, int *out_is_nrpa);
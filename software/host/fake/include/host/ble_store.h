@@ -0,0 +1,14 @@
+/// @file ble_store.h
+/// @brief host stand-in for the nimble bond store
+
+#pragma once
+
+#include "nimble/ble.h"
+
+struct ble_store_status_event {
+  int event_code;
+};
+
+int ble_store_util_status_rr(ble_store_status_event *event, void *arg);
+int ble_store_util_delete_peer(ble_addr_t const *peer_id_addr);
+extern "C" void ble_store_config_init();
@@ -0,0 +1,6 @@
+/// @file util.h
+/// @brief host stand-in for nimble host utilities
+
+#pragma once
+
+int ble_hs_util_ensure_addr(int prefer_random);
@@ -0,0 +1,115 @@
+/// @file sha256.h
+/// @brief host stand-in for the mbedtls sha256 api used by ota_transfer.hpp
+/// @copyright GPL v2.0
+///
+/// plain fips 180-4 sha256, so host builds need no mbedtls installation
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+struct mbedtls_sha256_context {
+  std::array<uint32_t, 8> state;
+  std::array<uint8_t, 64> block;
+  size_t block_used;
+  uint64_t total_bytes;
+};
+
+namespace mbedtls_stub {
+
+inline uint32_t rotr(uint32_t x, int n) { return x >> n | x << (32 - n); }
+
+inline void compress(mbedtls_sha256_context *ctx, uint8_t const *block) {
+  constexpr std::array<uint32_t, 64> k = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+      0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+      0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+      0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+      0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+      0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+      0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+      0xc67178f2,
+  };
+
+  std::array<uint32_t, 64> w;
+  for (size_t i = 0; i < 16; ++i) {
+    w[i] = static_cast<uint32_t>(block[4 * i]) << 24 | block[4 * i + 1] << 16 |
+           block[4 * i + 2] << 8 | block[4 * i + 3];
+  }
+  for (size_t i = 16; i < 64; ++i) {
+    uint32_t const s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ w[i - 15] >> 3;
+    uint32_t const s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ w[i - 2] >> 10;
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  auto s = ctx->state;
+  for (size_t i = 0; i < 64; ++i) {
+    uint32_t const t1 = s[7] + (rotr(s[4], 6) ^ rotr(s[4], 11) ^ rotr(s[4], 25)) +
+                        ((s[4] & s[5]) ^ (~s[4] & s[6])) + k[i] + w[i];
+    uint32_t const t2 = (rotr(s[0], 2) ^ rotr(s[0], 13) ^ rotr(s[0], 22)) +
+                        ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+    s = {t1 + t2, s[0], s[1], s[2], s[3] + t1, s[4], s[5], s[6]};
+  }
+  for (size_t i = 0; i < 8; ++i) {
+    ctx->state[i] += s[i];
+  }
+}
+
+}  // namespace mbedtls_stub
+
+inline void mbedtls_sha256_init(mbedtls_sha256_context *ctx) { *ctx = {}; }
+
+inline void mbedtls_sha256_free(mbedtls_sha256_context *) {}
+
+inline int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224) {
+  ctx->state = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  ctx->block_used = 0;
+  ctx->total_bytes = 0;
+  return is224 == 0 ? 0 : -1;
+}
+
+inline int mbedtls_sha256_update(mbedtls_sha256_context *ctx, unsigned char const *input,
+                                 size_t len) {
+  ctx->total_bytes += len;
+  while (len > 0) {
+    size_t const n = std::min(len, ctx->block.size() - ctx->block_used);
+    std::memcpy(ctx->block.data() + ctx->block_used, input, n);
+    ctx->block_used += n;
+    input += n;
+    len -= n;
+    if (ctx->block_used == ctx->block.size()) {
+      mbedtls_stub::compress(ctx, ctx->block.data());
+      ctx->block_used = 0;
+    }
+  }
+  return 0;
+}
+
+inline int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output) {
+  uint64_t const total_bits = ctx->total_bytes * 8;
+  uint8_t const pad_start = 0x80;
+  uint8_t const zero = 0;
+  mbedtls_sha256_update(ctx, &pad_start, 1);
+  while (ctx->block_used != 56) {
+    mbedtls_sha256_update(ctx, &zero, 1);
+  }
+  std::array<uint8_t, 8> length;
+  for (size_t i = 0; i < 8; ++i) {
+    length[i] = static_cast<uint8_t>(total_bits >> (56 - 8 * i));
+  }
+  mbedtls_sha256_update(ctx, length.data(), length.size());
+  for (size_t i = 0; i < 8; ++i) {
+    output[4 * i] = static_cast<uint8_t>(ctx->state[i] >> 24);
+    output[4 * i + 1] = static_cast<uint8_t>(ctx->state[i] >> 16);
+    output[4 * i + 2] = static_cast<uint8_t>(ctx->state[i] >> 8);
+    output[4 * i + 3] = static_cast<uint8_t>(ctx->state[i]);
+  }
+  return 0;
+}
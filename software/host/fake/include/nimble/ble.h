@@ -0,0 +1,14 @@
+/// @file ble.h
+/// @brief host stand-in for nimble address types
+
+#pragma once
+
+#include <cstdint>
+
+constexpr uint8_t BLE_ADDR_PUBLIC = 0;
+constexpr uint8_t BLE_ADDR_RANDOM = 1;
+
+typedef struct {
+  uint8_t type;
+  uint8_t val[6];
+} ble_addr_t;
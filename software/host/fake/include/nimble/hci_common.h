@@ -0,0 +1,7 @@
+/// @file hci_common.h
+/// @brief host stand-in for nimble hci definitions
+
+#pragma once
+
+constexpr int BLE_ERR_UNSPECIFIED = 0x1f;
+constexpr int BLE_ERR_REM_USER_CONN_TERM = 0x13;
@@ -0,0 +1,10 @@
+/// @file nimble_port.h
+/// @brief host stand-in for the nimble port. nimble_port_run syncs the host and hands over to
+/// the loop installed with fake::set_host_loop
+
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t nimble_port_init();
+void nimble_port_run();
@@ -0,0 +1,6 @@
+/// @file nimble_port_freertos.h
+/// @brief host stand-in for the nimble freertos port
+
+#pragma once
+
+#include "nimble/nimble_port.h"
@@ -0,0 +1,21 @@
+/// @file nvs.h
+/// @brief host stand-in for esp-idf non volatile storage, kept in memory
+
+#pragma once
+
+#include <cstddef>
+
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+  NVS_READONLY,
+  NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(char const *name, nvs_open_mode_t mode, nvs_handle_t *handle);
+esp_err_t nvs_set_blob(nvs_handle_t handle, char const *key, void const *value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, char const *key, void *value, size_t *length);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
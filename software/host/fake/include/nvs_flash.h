@@ -0,0 +1,9 @@
+/// @file nvs_flash.h
+/// @brief host stand-in for esp-idf nvs flash initialization
+
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init();
+esp_err_t nvs_flash_erase();
@@ -0,0 +1,21 @@
+/// @file os_mbuf.h
+/// @brief host stand-in for nimble memory buffers, always a single chunk
+
+#pragma once
+
+#include <cstdint>
+
+struct os_mbuf {
+  uint8_t *om_data;
+  uint16_t om_len;
+  /// room behind om_data
+  uint16_t capacity;
+  uint8_t storage[600];
+};
+
+#define OS_MBUF_PKTLEN(om) ((om)->om_len)
+
+constexpr int OS_ENOMEM = 1;
+
+int os_mbuf_append(os_mbuf *om, void const *data, uint16_t len);
+int os_mbuf_free_chain(os_mbuf *om);
@@ -0,0 +1,15 @@
+/// @file sdkconfig.h
+/// @brief configuration of the host build, kconfig defaults with every optional module enabled
+
+#pragma once
+
+#define CONFIG_BLINK_GPIO 8
+#define CONFIG_BLINK_LED_STRIP 1
+#define CONFIG_BLINK_LED_STRIP_BACKEND_RMT 1
+#define CONFIG_TRAIN_LED_STRIP_COUNT 4
+#define CONFIG_TRAIN_TACHO_GPIO 1
+#define CONFIG_TRAIN_LATENCY_TRACE 1
+#define CONFIG_TRAIN_BLE_TASK_STACK_SIZE 8192
+#define CONFIG_TRAIN_SPEED_CONTROL_TASK_STACK_SIZE 4096
+#define CONFIG_TRAIN_STATIC_ALLOCATION 1
+#define CONFIG_TRAIN_STATIC_RAM_BUDGET 20480
@@ -0,0 +1,7 @@
+/// @file ble_svc_gap.h
+/// @brief host stand-in for the nimble gap service
+
+#pragma once
+
+void ble_svc_gap_init();
+int ble_svc_gap_device_name_set(char const *name);
@@ -0,0 +1,6 @@
+/// @file ble_svc_gatt.h
+/// @brief host stand-in for the nimble gatt service
+
+#pragma once
+
+void ble_svc_gatt_init();
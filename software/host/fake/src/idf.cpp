@@ -0,0 +1,396 @@
+/// @file idf.cpp
+/// @brief host implementation of the esp-idf stand-ins
+/// @copyright GPL v2.0
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "driver/gpio.h"
+#include "driver/gptimer.h"
+#include "driver/mcpwm_gen.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "fake/host.hpp"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "led_strip.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+namespace fake {
+
+esp_log_level_t log_level = ESP_LOG_NONE;
+
+Counters counters;
+
+esp_ota_img_states_t running_image_state = ESP_OTA_IMG_PENDING_VERIFY;
+
+void log(esp_log_level_t level, char const *tag, char const *format, ...) {
+  if (level > log_level) {
+    return;
+  }
+  std::printf("%s: ", tag);
+  va_list args;
+  va_start(args, format);
+  std::vprintf(format, args);
+  va_end(args);
+  std::printf("\n");
+}
+
+namespace {
+
+/// distinct non null handle for drivers without state
+template <typename Handle> Handle dummy_handle() {
+  static char storage;
+  return reinterpret_cast<Handle>(&storage);
+}
+
+}  // namespace
+
+}  // namespace fake
+
+namespace fake {
+namespace {
+
+int64_t time_offset_us = 0;
+
+std::array<std::pair<gpio_isr_t, void *>, GPIO_NUM_MAX> isr_handlers = {};
+
+uint32_t compare_value = 0;
+
+}  // namespace
+}  // namespace fake
+
+void fake::advance_time_us(int64_t us) { time_offset_us += us; }
+
+void fake::gpio_edge(gpio_num_t gpio) {
+  auto const [handler, arg] = isr_handlers.at(gpio);
+  if (handler != nullptr) {
+    handler(arg);
+  }
+}
+
+uint32_t fake::mcpwm_compare_value() { return compare_value; }
+
+int64_t esp_timer_get_time() {
+  static auto const start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                               start)
+             .count() +
+         fake::time_offset_us;
+}
+
+struct esp_timer {
+  esp_timer_create_args_t args;
+  bool armed = false;
+};
+
+namespace {
+
+std::vector<std::unique_ptr<esp_timer>> &timers() {
+  static std::vector<std::unique_ptr<esp_timer>> instances;
+  return instances;
+}
+
+}  // namespace
+
+void fake::fire_timers() {
+  for (auto const &timer : timers()) {
+    if (timer && timer->armed) {
+      timer->args.callback(timer->args.arg);
+    }
+  }
+}
+
+esp_err_t esp_timer_create(esp_timer_create_args_t const *args, esp_timer_handle_t *handle) {
+  timers().push_back(std::make_unique<esp_timer>(*args));
+  *handle = timers().back().get();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+  timer->armed = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->armed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  for (auto &instance : timers()) {
+    if (instance.get() == timer) {
+      instance.reset();
+    }
+  }
+  return ESP_OK;
+}
+
+void esp_restart() { throw std::runtime_error("esp_restart called on host"); }
+
+BaseType_t xTaskCreate(TaskFunction_t, char const *, uint32_t, void *, UBaseType_t,
+                       TaskHandle_t *handle) {
+  if (handle != nullptr) {
+    *handle = fake::dummy_handle<TaskHandle_t>();
+  }
+  return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t, char const *, uint32_t, void *, UBaseType_t,
+                               StackType_t *, StaticTask_t *buffer) {
+  return reinterpret_cast<TaskHandle_t>(buffer);
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+void vTaskDelay(TickType_t) {}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t period) { *previous_wake += period; }
+
+TickType_t xTaskGetTickCount() { return pdMS_TO_TICKS(esp_timer_get_time() / 1000); }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 1; }
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer) {
+  return reinterpret_cast<SemaphoreHandle_t>(buffer);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+void vSemaphoreDelete(SemaphoreHandle_t) {}
+
+esp_err_t gpio_config(gpio_config_t const *) { return ESP_OK; }
+esp_err_t gpio_reset_pin(gpio_num_t) { return ESP_OK; }
+esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t) { return ESP_OK; }
+esp_err_t gpio_set_level(gpio_num_t, uint32_t) { return ESP_OK; }
+int gpio_get_level(gpio_num_t) { return 0; }
+esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t handler, void *arg) {
+  fake::isr_handlers.at(gpio) = {handler, arg};
+  return ESP_OK;
+}
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio) {
+  fake::isr_handlers.at(gpio) = {};
+  return ESP_OK;
+}
+
+struct gptimer_t {
+  uint32_t resolution_hz;
+};
+
+esp_err_t gptimer_new_timer(gptimer_config_t const *cfg, gptimer_handle_t *handle) {
+  *handle = new gptimer_t{cfg->resolution_hz};
+  return ESP_OK;
+}
+
+esp_err_t gptimer_del_timer(gptimer_handle_t timer) {
+  delete timer;
+  return ESP_OK;
+}
+
+esp_err_t gptimer_enable(gptimer_handle_t) { return ESP_OK; }
+esp_err_t gptimer_disable(gptimer_handle_t) { return ESP_OK; }
+esp_err_t gptimer_start(gptimer_handle_t) { return ESP_OK; }
+esp_err_t gptimer_stop(gptimer_handle_t) { return ESP_OK; }
+
+esp_err_t gptimer_get_raw_count(gptimer_handle_t timer, uint64_t *count) {
+  *count = static_cast<uint64_t>(esp_timer_get_time()) * timer->resolution_hz / 1000000;
+  return ESP_OK;
+}
+
+esp_err_t mcpwm_new_timer(mcpwm_timer_config_t const *, mcpwm_timer_handle_t *handle) {
+  *handle = fake::dummy_handle<mcpwm_timer_handle_t>();
+  return ESP_OK;
+}
+esp_err_t mcpwm_del_timer(mcpwm_timer_handle_t) { return ESP_OK; }
+esp_err_t mcpwm_timer_enable(mcpwm_timer_handle_t) { return ESP_OK; }
+esp_err_t mcpwm_timer_disable(mcpwm_timer_handle_t) { return ESP_OK; }
+esp_err_t mcpwm_timer_start_stop(mcpwm_timer_handle_t, mcpwm_timer_start_stop_cmd_t) {
+  return ESP_OK;
+}
+esp_err_t mcpwm_timer_set_period(mcpwm_timer_handle_t, uint32_t) { return ESP_OK; }
+
+esp_err_t mcpwm_new_operator(mcpwm_operator_config_t const *, mcpwm_oper_handle_t *handle) {
+  *handle = fake::dummy_handle<mcpwm_oper_handle_t>();
+  return ESP_OK;
+}
+esp_err_t mcpwm_del_operator(mcpwm_oper_handle_t) { return ESP_OK; }
+esp_err_t mcpwm_operator_connect_timer(mcpwm_oper_handle_t, mcpwm_timer_handle_t) {
+  return ESP_OK;
+}
+
+esp_err_t mcpwm_new_comparator(mcpwm_oper_handle_t, mcpwm_comparator_config_t const *,
+                               mcpwm_cmpr_handle_t *handle) {
+  *handle = fake::dummy_handle<mcpwm_cmpr_handle_t>();
+  return ESP_OK;
+}
+esp_err_t mcpwm_del_comparator(mcpwm_cmpr_handle_t) { return ESP_OK; }
+esp_err_t mcpwm_comparator_set_compare_value(mcpwm_cmpr_handle_t, uint32_t value) {
+  fake::compare_value = value;
+  return ESP_OK;
+}
+
+esp_err_t mcpwm_new_generator(mcpwm_oper_handle_t, mcpwm_generator_config_t const *,
+                              mcpwm_gen_handle_t *handle) {
+  *handle = fake::dummy_handle<mcpwm_gen_handle_t>();
+  return ESP_OK;
+}
+esp_err_t mcpwm_del_generator(mcpwm_gen_handle_t) { return ESP_OK; }
+esp_err_t mcpwm_generator_set_action_on_timer_event(mcpwm_gen_handle_t,
+                                                    mcpwm_gen_timer_event_action_t) {
+  return ESP_OK;
+}
+esp_err_t mcpwm_generator_set_action_on_compare_event(mcpwm_gen_handle_t,
+                                                      mcpwm_gen_compare_event_action_t) {
+  return ESP_OK;
+}
+
+esp_err_t adc_oneshot_new_unit(adc_oneshot_unit_init_cfg_t const *,
+                               adc_oneshot_unit_handle_t *handle) {
+  *handle = fake::dummy_handle<adc_oneshot_unit_handle_t>();
+  return ESP_OK;
+}
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t, adc_channel_t,
+                                     adc_oneshot_chan_cfg_t const *) {
+  return ESP_OK;
+}
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t, adc_channel_t, int *raw) {
+  *raw = 2800;
+  return ESP_OK;
+}
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t) { return ESP_OK; }
+
+esp_err_t adc_cali_create_scheme_curve_fitting(adc_cali_curve_fitting_config_t const *,
+                                               adc_cali_handle_t *handle) {
+  *handle = fake::dummy_handle<adc_cali_handle_t>();
+  return ESP_OK;
+}
+esp_err_t adc_cali_delete_scheme_curve_fitting(adc_cali_handle_t) { return ESP_OK; }
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t, int raw, int *voltage_mv) {
+  // full scale near 950 mV without attenuation
+  *voltage_mv = raw * 950 / 4095;
+  return ESP_OK;
+}
+
+esp_err_t led_strip_new_rmt_device(led_strip_config_t const *, led_strip_rmt_config_t const *,
+                                   led_strip_handle_t *handle) {
+  *handle = fake::dummy_handle<led_strip_handle_t>();
+  return ESP_OK;
+}
+esp_err_t led_strip_set_pixel(led_strip_handle_t, uint32_t, uint32_t, uint32_t, uint32_t) {
+  return ESP_OK;
+}
+esp_err_t led_strip_refresh(led_strip_handle_t) {
+  ++fake::counters.led_refreshes;
+  return ESP_OK;
+}
+esp_err_t led_strip_clear(led_strip_handle_t) { return ESP_OK; }
+esp_err_t led_strip_del(led_strip_handle_t) { return ESP_OK; }
+
+namespace {
+
+std::map<std::string, std::vector<uint8_t>> &nvs_blobs() {
+  static std::map<std::string, std::vector<uint8_t>> blobs;
+  return blobs;
+}
+
+std::vector<std::string> &nvs_namespaces() {
+  static std::vector<std::string> names;
+  return names;
+}
+
+std::string nvs_key(nvs_handle_t handle, char const *key) {
+  return nvs_namespaces().at(handle) + "/" + key;
+}
+
+}  // namespace
+
+esp_err_t nvs_flash_init() { return ESP_OK; }
+esp_err_t nvs_flash_erase() {
+  nvs_blobs().clear();
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(char const *name, nvs_open_mode_t, nvs_handle_t *handle) {
+  auto &names = nvs_namespaces();
+  auto const found = std::find(names.begin(), names.end(), name);
+  *handle = found - names.begin();
+  if (found == names.end()) {
+    names.push_back(name);
+  }
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, char const *key, void const *value, size_t length) {
+  auto const *bytes = static_cast<uint8_t const *>(value);
+  nvs_blobs()[nvs_key(handle, key)].assign(bytes, bytes + length);
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, char const *key, void *value, size_t *length) {
+  auto const blob = nvs_blobs().find(nvs_key(handle, key));
+  if (blob == nvs_blobs().end()) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (value != nullptr) {
+    std::copy_n(blob->second.begin(), std::min(*length, blob->second.size()),
+                static_cast<uint8_t *>(value));
+  }
+  *length = blob->second.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t) { return ESP_OK; }
+void nvs_close(nvs_handle_t) {}
+
+esp_partition_t const *esp_ota_get_next_update_partition(esp_partition_t const *) {
+  static esp_partition_t const partition = {0x110000, 0x100000, "ota_1"};
+  return &partition;
+}
+
+esp_err_t esp_ota_begin(esp_partition_t const *, size_t, esp_ota_handle_t *handle) {
+  *handle = 1;
+  return ESP_OK;
+}
+esp_err_t esp_ota_write(esp_ota_handle_t, void const *, size_t) { return ESP_OK; }
+esp_err_t esp_ota_end(esp_ota_handle_t) { return ESP_OK; }
+esp_err_t esp_ota_abort(esp_ota_handle_t) { return ESP_OK; }
+esp_err_t esp_ota_set_boot_partition(esp_partition_t const *) { return ESP_OK; }
+
+esp_partition_t const *esp_ota_get_running_partition() {
+  static esp_partition_t const partition = {0x10000, 0x100000, "ota_0"};
+  return &partition;
+}
+
+esp_err_t esp_ota_get_state_partition(esp_partition_t const *, esp_ota_img_states_t *ota_state) {
+  *ota_state = fake::running_image_state;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() {
+  fake::running_image_state = ESP_OTA_IMG_VALID;
+  return ESP_OK;
+}
@@ -0,0 +1,251 @@
+/// @file nimble.cpp
+/// @brief host implementation of the nimble stand-ins. connections, bonds and the gatt table are
+/// plain containers the harness manipulates through fake/host.hpp
+/// @copyright GPL v2.0
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include "fake/host.hpp"
+#include "host/ble_hs.h"
+#include "host/util/util.h"
+#include "nimble/nimble_port.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+
+ble_hs_cfg_t ble_hs_cfg;
+
+namespace fake {
+
+Failures failures;
+
+namespace {
+
+std::map<uint16_t, Link> &links() {
+  static std::map<uint16_t, Link> instances;
+  return instances;
+}
+
+std::vector<Attribute> &registered_attributes() {
+  static std::vector<Attribute> instances;
+  return instances;
+}
+
+std::function<void()> &host_loop() {
+  static std::function<void()> loop;
+  return loop;
+}
+
+}  // namespace
+
+void connect(Link const &link) { links()[link.conn_handle] = link; }
+
+void disconnect(uint16_t conn_handle) { links().erase(conn_handle); }
+
+std::vector<Attribute> const &attributes() { return registered_attributes(); }
+
+Attribute const *find_attribute(uint16_t handle) {
+  auto const &all = registered_attributes();
+  auto const found = std::find_if(all.begin(), all.end(),
+                                  [handle](Attribute const &a) { return a.handle == handle; });
+  return found == all.end() ? nullptr : &*found;
+}
+
+void init_mbuf(os_mbuf &om, std::span<uint8_t const> data) {
+  om.om_data = om.storage;
+  om.capacity = sizeof(om.storage);
+  om.om_len = static_cast<uint16_t>(std::min(data.size(), sizeof(om.storage)));
+  std::copy_n(data.begin(), om.om_len, om.storage);
+}
+
+int access_unchecked(uint16_t conn_handle, uint16_t attr_handle, uint8_t op,
+                     std::span<uint8_t const> data) {
+  Attribute const *attribute = find_attribute(attr_handle);
+  if (attribute == nullptr) {
+    return BLE_ATT_ERR_INVALID_HANDLE;
+  }
+  os_mbuf om;
+  bool const write = op == BLE_GATT_ACCESS_OP_WRITE_CHR || op == BLE_GATT_ACCESS_OP_WRITE_DSC;
+  init_mbuf(om, write ? data : std::span<uint8_t const>{});
+  ble_gatt_access_ctxt ctxt = {.op = op, .om = &om, .chr = attribute->chr};
+  return attribute->chr->access_cb(conn_handle, attr_handle, &ctxt, attribute->chr->arg);
+}
+
+int access(uint16_t conn_handle, uint16_t attr_handle, uint8_t op, std::span<uint8_t const> data) {
+  Attribute const *attribute = find_attribute(attr_handle);
+  if (attribute == nullptr) {
+    return BLE_ATT_ERR_INVALID_HANDLE;
+  }
+  ble_gatt_chr_flags const flags = attribute->chr->flags;
+  auto const link = links().find(conn_handle);
+  bool const encrypted = link != links().end() && link->second.encrypted;
+  if (op == BLE_GATT_ACCESS_OP_READ_CHR) {
+    if ((flags & BLE_GATT_CHR_F_READ) == 0) {
+      return BLE_ATT_ERR_READ_NOT_PERMITTED;
+    }
+    if ((flags & BLE_GATT_CHR_F_READ_ENC) != 0 && !encrypted) {
+      return BLE_ATT_ERR_INSUFFICIENT_ENC;
+    }
+  } else if (op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    if ((flags & (BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP)) == 0) {
+      return BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+    }
+    if ((flags & BLE_GATT_CHR_F_WRITE_ENC) != 0 && !encrypted) {
+      return BLE_ATT_ERR_INSUFFICIENT_ENC;
+    }
+  } else {
+    return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+  }
+  return access_unchecked(conn_handle, attr_handle, op, data);
+}
+
+void set_host_loop(std::function<void()> loop) { host_loop() = std::move(loop); }
+
+}  // namespace fake
+
+int os_mbuf_append(os_mbuf *om, void const *data, uint16_t len) {
+  if (fake::failures.mbuf_append || om->om_len + len > om->capacity) {
+    return OS_ENOMEM;
+  }
+  std::memcpy(om->om_data + om->om_len, data, len);
+  om->om_len += len;
+  return 0;
+}
+
+int os_mbuf_free_chain(os_mbuf *om) {
+  delete om;
+  return 0;
+}
+
+int ble_hs_mbuf_to_flat(os_mbuf const *om, void *flat, uint16_t max_len, uint16_t *out_copy_len) {
+  uint16_t const len = std::min(om->om_len, max_len);
+  std::memcpy(flat, om->om_data, len);
+  if (out_copy_len != nullptr) {
+    *out_copy_len = len;
+  }
+  return len < om->om_len ? BLE_HS_EMSGSIZE : 0;
+}
+
+os_mbuf *ble_hs_mbuf_from_flat(void const *buf, uint16_t len) {
+  if (fake::failures.mbuf_alloc) {
+    return nullptr;
+  }
+  auto *om = new os_mbuf;
+  fake::init_mbuf(*om, {static_cast<uint8_t const *>(buf), len});
+  return om;
+}
+
+int ble_gap_conn_find(uint16_t handle, ble_gap_conn_desc *out_desc) {
+  auto const link = fake::links().find(handle);
+  if (fake::failures.conn_find || link == fake::links().end()) {
+    return BLE_HS_ENOTCONN;
+  }
+  *out_desc = {};
+  out_desc->sec_state.encrypted = link->second.encrypted;
+  out_desc->sec_state.bonded = link->second.bonded;
+  out_desc->conn_handle = handle;
+  out_desc->conn_itvl = 24;
+  out_desc->supervision_timeout = 400;
+  out_desc->peer_id_addr.val[0] = static_cast<uint8_t>(handle);
+  return 0;
+}
+
+int ble_gap_update_params(uint16_t conn_handle, ble_gap_upd_params const *) {
+  if (fake::failures.update_params || !fake::links().contains(conn_handle)) {
+    return BLE_HS_ENOTCONN;
+  }
+  return 0;
+}
+
+int ble_gap_adv_set_fields(ble_hs_adv_fields const *) { return 0; }
+
+int ble_gap_adv_rsp_set_fields(ble_hs_adv_fields const *) { return 0; }
+
+int ble_gap_adv_start(uint8_t, ble_addr_t const *, int32_t, ble_gap_adv_params const *,
+                      ble_gap_event_fn *, void *) {
+  if (fake::failures.adv_start) {
+    return BLE_HS_EALREADY;
+  }
+  ++fake::counters.advertising_starts;
+  return 0;
+}
+
+int ble_gap_adv_stop() { return 0; }
+
+// the harness fires advertising events itself, every start attempt reaches ble_gap_adv_start
+int ble_gap_adv_active() { return 0; }
+
+void ble_hs_sched_reset(int) { ++fake::counters.host_resets; }
+
+int ble_gatts_count_cfg(ble_gatt_svc_def const *) { return 0; }
+
+int ble_gatts_add_svcs(ble_gatt_svc_def const *services) {
+  // handles as nimble assigns them: service declaration, then declaration and value per
+  // characteristic
+  uint16_t handle = 1;
+  for (auto const *service = services; service->type != BLE_GATT_SVC_TYPE_END; ++service) {
+    ++handle;
+    for (auto const *chr = service->characteristics; chr->uuid != nullptr; ++chr) {
+      ++handle;
+      uint16_t const value_handle = handle++;
+      if (chr->val_handle != nullptr) {
+        *chr->val_handle = value_handle;
+      }
+      fake::registered_attributes().push_back({value_handle, chr});
+    }
+  }
+  return 0;
+}
+
+int ble_gatts_notify_custom(uint16_t conn_handle, uint16_t, os_mbuf *om) {
+  os_mbuf_free_chain(om);
+  if (fake::failures.notify || !fake::links().contains(conn_handle)) {
+    return BLE_HS_ENOTCONN;
+  }
+  ++fake::counters.notifications;
+  return 0;
+}
+
+int ble_hs_id_infer_auto(int, uint8_t *out_addr_type) {
+  *out_addr_type = BLE_ADDR_PUBLIC;
+  return 0;
+}
+
+int ble_hs_id_copy_addr(uint8_t, uint8_t *out_id_addr, int *out_is_nrpa) {
+  static constexpr uint8_t address[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+  std::memcpy(out_id_addr, address, sizeof(address));
+  if (out_is_nrpa != nullptr) {
+    *out_is_nrpa = 0;
+  }
+  return 0;
+}
+
+int ble_hs_util_ensure_addr(int) { return fake::failures.ensure_addr ? BLE_HS_ENOENT : 0; }
+
+int ble_store_util_status_rr(ble_store_status_event *, void *) { return 0; }
+
+int ble_store_util_delete_peer(ble_addr_t const *) {
+  ++fake::counters.deleted_peers;
+  return 0;
+}
+
+extern "C" void ble_store_config_init() {}
+
+void ble_svc_gap_init() {}
+
+int ble_svc_gap_device_name_set(char const *) { return 0; }
+
+void ble_svc_gatt_init() {}
+
+esp_err_t nimble_port_init() { return ESP_OK; }
+
+void nimble_port_run() {
+  if (ble_hs_cfg.sync_cb != nullptr) {
+    ble_hs_cfg.sync_cb();
+  }
+  if (fake::host_loop()) {
+    fake::host_loop()();
+  }
+}
@@ -0,0 +1,194 @@
+/// @file ota_transfer_test.cpp
+/// @brief host test of the chunked firmware transfer
+/// @copyright GPL v2.0
+
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+#include "ota_transfer.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, char const *what) {
+  if (!condition) {
+    std::printf("FAIL: %s\n", what);
+    ++failures;
+  }
+}
+
+/// records what the transfer does to the flash
+struct FakeSink {
+  bool begin(uint32_t) {
+    begun = accept_begin;
+    image.clear();
+    return accept_begin;
+  }
+  bool write(std::span<uint8_t const> data) {
+    image.insert(image.end(), data.begin(), data.end());
+    return accept_write;
+  }
+  bool end() {
+    ended = true;
+    return true;
+  }
+  void abort() { aborted = true; }
+
+  bool accept_begin = true;
+  bool accept_write = true;
+  bool begun = false;
+  bool ended = false;
+  bool aborted = false;
+  std::vector<uint8_t> image;
+};
+
+using Transfer = ota::Transfer<FakeSink>;
+using Reply = Transfer::Reply;
+
+ota::Hash sha256(std::span<uint8_t const> data) {
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, data.data(), data.size());
+  ota::Hash hash;
+  mbedtls_sha256_finish(&ctx, hash.data());
+  mbedtls_sha256_free(&ctx);
+  return hash;
+}
+
+ota::Hash sha256(std::string_view text) {
+  return sha256(std::span(reinterpret_cast<uint8_t const *>(text.data()), text.size()));
+}
+
+std::vector<uint8_t> make_image(size_t size) {
+  std::vector<uint8_t> image(size);
+  std::iota(image.begin(), image.end(), uint8_t{7});
+  return image;
+}
+
+constexpr size_t chunk_size = 100;
+
+std::span<uint8_t const> chunk(std::vector<uint8_t> const &image, uint16_t sequence) {
+  size_t const offset = sequence * chunk_size;
+  return std::span(image).subspan(offset, std::min(chunk_size, image.size() - offset));
+}
+
+void test_sha256_known_answers() {
+  check(sha256("abc") == ota::Hash{0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+                                   0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+                                   0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+                                   0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad},
+        "sha256 of abc");
+  check(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+            ota::Hash{0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26,
+                      0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff,
+                      0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1},
+        "sha256 of two block message");
+}
+
+void test_in_order_transfer() {
+  FakeSink sink;
+  Transfer transfer(sink);
+  auto const image = make_image(950);
+
+  check(transfer.begin(image.size(), 4), "begin accepted");
+  std::vector<uint16_t> acks;
+  for (uint16_t sequence = 0; sequence < 10; ++sequence) {
+    auto const response = transfer.on_chunk(sequence, chunk(image, sequence));
+    if (response) {
+      check(response->reply == Reply::ack, "only acks in order");
+      acks.push_back(response->next_sequence);
+    }
+  }
+  check(acks == std::vector<uint16_t>{4, 8, 10}, "ack after every window and at the end");
+
+  auto const response = transfer.finish(sha256(image));
+  check(response.reply == Reply::done, "verified image done");
+  check(response.received == image.size(), "all bytes received");
+  check(sink.image == image, "sink got the image");
+  check(sink.ended && !sink.aborted, "sink finalized");
+  check(!transfer.active(), "inactive after finish");
+}
+
+void test_gap_is_nacked_once() {
+  FakeSink sink;
+  Transfer transfer(sink);
+  auto const image = make_image(500);
+
+  transfer.begin(image.size(), 8);
+  transfer.on_chunk(0, chunk(image, 0));
+
+  auto const nak = transfer.on_chunk(2, chunk(image, 2));
+  check(nak && nak->reply == Reply::nak && nak->next_sequence == 1, "gap nacked");
+  check(!transfer.on_chunk(3, chunk(image, 3)), "chunks behind the gap dropped silently");
+
+  for (uint16_t sequence = 1; sequence < 5; ++sequence) {
+    transfer.on_chunk(sequence, chunk(image, sequence));
+  }
+  check(transfer.finish(sha256(image)).reply == Reply::done, "resent image done");
+  check(sink.image == image, "no chunk written twice");
+}
+
+void test_hash_mismatch_aborts() {
+  FakeSink sink;
+  Transfer transfer(sink);
+  auto const image = make_image(200);
+
+  transfer.begin(image.size(), 1);
+  transfer.on_chunk(0, chunk(image, 0));
+  transfer.on_chunk(1, chunk(image, 1));
+
+  ota::Hash wrong = sha256(image);
+  wrong[0] ^= 1;
+  check(transfer.finish(wrong).reply == Reply::error, "wrong hash rejected");
+  check(sink.aborted && !sink.ended, "partition not activated");
+}
+
+void test_invalid_use() {
+  FakeSink sink;
+  Transfer transfer(sink);
+  auto const image = make_image(150);
+
+  auto const idle = transfer.on_chunk(0, chunk(image, 0));
+  check(idle && idle->reply == Reply::error, "chunk without begin rejected");
+
+  check(!transfer.begin(0, 1), "empty image rejected");
+  check(!transfer.begin(image.size(), 0), "zero window rejected");
+
+  transfer.begin(100, 1);
+  auto const fits = transfer.on_chunk(0, chunk(image, 0));
+  check(fits && fits->reply == Reply::ack, "chunk up to image size accepted");
+  auto const overflow = transfer.on_chunk(1, chunk(image, 1));
+  check(overflow && overflow->reply == Reply::error, "data beyond image size rejected");
+  check(sink.aborted && !transfer.active(), "overflow aborts");
+
+  transfer.begin(image.size(), 1);
+  transfer.on_chunk(0, chunk(image, 0));
+  check(transfer.finish(sha256(image)).reply == Reply::error, "incomplete image rejected");
+
+  sink.accept_begin = false;
+  check(!transfer.begin(image.size(), 1), "failing sink refuses begin");
+
+  sink = {};
+  sink.accept_write = false;
+  transfer.begin(image.size(), 1);
+  auto const failed = transfer.on_chunk(0, chunk(image, 0));
+  check(failed && failed->reply == Reply::error, "flash write error reported");
+}
+
+}  // namespace
+
+int main() {
+  test_sha256_known_answers();
+  test_in_order_transfer();
+  test_gap_is_nacked_once();
+  test_hash_mismatch_aborts();
+  test_invalid_use();
+
+  std::printf("ota transfer: %d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
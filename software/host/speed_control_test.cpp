@@ -0,0 +1,256 @@
+/// @file speed_control_test.cpp
+/// @brief host test of pid, speed observer and the closed loop with tacho pulses
+/// @copyright GPL v2.0
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "fake/host.hpp"
+#include "speed_ctrl.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, char const *what) {
+  if (!condition) {
+    std::printf("FAIL: %s\n", what);
+    ++failures;
+  }
+}
+
+/// compare value of zero duty with the default pwm period of 500 ticks
+constexpr uint32_t zero_duty_compare = 250;
+
+constexpr auto tacho_gpio = static_cast<gpio_num_t>(CONFIG_TRAIN_TACHO_GPIO);
+
+constexpr drive::MotorControl::Config motor_cfg = {
+    .timer_cfg = {.resolution_hz = 10'000'000,
+                  .count_mode = MCPWM_TIMER_COUNT_MODE_UP,
+                  .period_ticks = 500,
+                  .flags = {.update_period_on_empty = true}},
+    .comparator_cfg = {.flags = {.update_cmp_on_tez = true}},
+    .bridge_a_gpio = GPIO_NUM_2,
+    .bridge_b_gpio = GPIO_NUM_21,
+    .enable_gpio = GPIO_NUM_23,
+    .standby_gpio = GPIO_NUM_16,
+    .nominal_supply_v = 3.7f,
+};
+
+constexpr int32_t half_duty = std::numeric_limits<int32_t>::max() / 2;
+
+uint32_t compare_for(drive::MotorControl &motor, int32_t duty) {
+  motor.set_duty(duty);
+  return fake::mcpwm_compare_value();
+}
+
+void test_supply_compensation() {
+  drive::MotorControl motor(motor_cfg);
+
+  check(compare_for(motor, 0) == zero_duty_compare, "zero duty at half period");
+  check(compare_for(motor, half_duty) == 374, "half duty without a battery sample");
+  check(compare_for(motor, -half_duty) == 126, "negative half duty");
+
+  // full cell: 125 ticks * 3.7 / 4.2
+  motor.set_supply_voltage(4.2f);
+  check(compare_for(motor, half_duty) == 360, "full battery scaled down");
+  // drained cell: 125 ticks * 3.7 / 3.0
+  motor.set_supply_voltage(3.0f);
+  check(compare_for(motor, half_duty) == 404, "drained battery scaled up");
+  check(compare_for(motor, std::numeric_limits<int32_t>::max()) == 500,
+        "scaled full duty clamped to the period");
+
+  motor.set_supply_voltage(10.f);
+  check(compare_for(motor, half_duty) == 404, "implausible voltage ignored");
+}
+
+void test_period_change_rescales_compare() {
+  drive::MotorControl motor(motor_cfg);
+  motor.set_duty(half_duty);
+  motor.set_period_ticks(250);
+  check(fake::mcpwm_compare_value() == 187, "compare rescaled with the period");
+  motor.set_period_ticks(1000);
+  check(fake::mcpwm_compare_value() == 749, "compare rescaled to a longer period");
+}
+
+using Constants = drive::DriveConstants<0.06f, 1, 1'000'000, 500>;
+
+constexpr drive::MeasureSpeed::Config measure_cfg = {
+    .wheel_circumpherance_m = 0.06f,
+    .timer_cfg = {.resolution_hz = 1'000'000},
+    .tacho_gpio = tacho_gpio,
+};
+
+void test_static_variant_matches_runtime() {
+  {
+    drive::StaticMotorControl<Constants> static_motor(motor_cfg);
+    drive::MotorControl motor(motor_cfg);
+    for (int32_t const duty : {0, half_duty, -half_duty, 12345678, -12345678,
+                               std::numeric_limits<int32_t>::max()}) {
+      static_motor.set_duty(duty);
+      uint32_t const static_compare = fake::mcpwm_compare_value();
+      // the shift rounds down where the division truncates, a tick apart at most
+      check(std::abs(static_cast<int>(static_compare) -
+                     static_cast<int>(compare_for(motor, duty))) <= 1,
+            "static compare mapping within a tick of runtime");
+    }
+  }
+
+  drive::StaticMeasureSpeed<Constants> static_measure(measure_cfg);
+  drive::MeasureSpeed measure(measure_cfg);
+  fake::advance_time_us(200'000);
+  static_measure.on_tacho_event();
+  measure.on_tacho_event();
+  static_measure.update();
+  measure.update();
+  check(std::abs(static_measure.get_speed_m_per_s() - 0.3f) < 0.003f,
+        "static speed per pulse");
+  check(std::abs(static_measure.get_speed_m_per_s() - measure.get_speed_m_per_s()) < 0.003f,
+        "static speed per pulse matches runtime");
+  check(static_measure.get_distance_m() == measure.get_distance_m(),
+        "static distance per pulse matches runtime");
+
+  drive::StaticSpeedControl<Constants> speed_control;
+  speed_control.set_ref_speed_m_per_s(0.3f);
+  fake::advance_time_us(drive::SpeedControl::control_period_ms * 1000);
+  speed_control.on_control_tick();
+  check(fake::mcpwm_compare_value() > zero_duty_compare, "static speed control drives");
+}
+
+void test_pid_clamps_without_windup() {
+  sig::PIDController<float> pid({
+      .amp_i = 0.1f,
+      .amp_p = 1,
+      .amp_d = 0,
+      .limit_max = 1,
+      .limit_min = -1,
+  });
+
+  float out = 0;
+  for (int i = 0; i < 100; ++i) {
+    out = pid.update(5);
+  }
+  check(out == 1, "output clamped to limit_max");
+  check(pid.value() <= 1, "integrator holds while saturated");
+  check(pid.update(-0.5f) < 0, "output follows error sign change at once");
+
+  for (int i = 0; i < 100; ++i) {
+    out = pid.update(-5);
+  }
+  check(out == -1, "output clamped to limit_min");
+  check(pid.update(0.5f) > 0, "no windup towards limit_min");
+}
+
+void test_observer_saturates() {
+  sig::SpeedObserver observer({
+      .time_constant_s = 0.3f,
+      .tick_period_s = 0.01f,
+      .speed_at_full_duty_m_per_s = 1,
+      .process_noise = 0.001f,
+      .measurement_noise = 0.01f,
+  });
+
+  observer.correct(1e9f);
+  float const saturated = observer.speed_m_per_s();
+  check(saturated > 0, "out of range measurement saturates instead of wrapping");
+
+  observer.limit(1e12f);
+  check(observer.speed_m_per_s() == saturated, "out of range bound leaves estimate");
+
+  observer.correct(-1e9f);
+  check(observer.speed_m_per_s() < saturated, "opposite saturated measurement does not overflow");
+}
+
+void tick(drive::SpeedControl &speed_control, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    fake::advance_time_us(drive::SpeedControl::control_period_ms * 1000);
+    speed_control.on_control_tick();
+  }
+}
+
+void test_backward_drive_and_braking() {
+  drive::SpeedControl speed_control;
+
+  speed_control.set_ref_speed_m_per_s(-0.3f);
+  tick(speed_control, 1);
+  check(fake::mcpwm_compare_value() < zero_duty_compare, "backward duty reaches the motor");
+
+  // one pulse of the 6 cm wheel per 200 ms is 0.3 m/s
+  for (int i = 0; i < 5; ++i) {
+    tick(speed_control, 20);
+    fake::gpio_edge(tacho_gpio);
+  }
+  tick(speed_control, 1);
+  check(speed_control.get_speed_m_per_s() < 0, "tacho speed taken as backward");
+  check(std::abs(speed_control.get_distance_m() - 5 * 0.06f) < 1e-4f,
+        "tacho isr counts distance");
+
+  speed_control.set_ref_speed_m_per_s(0);
+  tick(speed_control, 1);
+  check(fake::mcpwm_compare_value() > zero_duty_compare, "zero reference brakes forward");
+  tick(speed_control, 5);
+  fake::gpio_edge(tacho_gpio);
+  tick(speed_control, 1);
+  check(speed_control.get_speed_m_per_s() < 0, "braking keeps the direction of the tacho speed");
+}
+
+void test_start_from_standstill() {
+  drive::SpeedControl speed_control;
+  tick(speed_control, 500);
+
+  // the first pulse of the 6 cm wheel is still ahead, at 0.3 m/s 200 ms away
+  speed_control.set_ref_speed_m_per_s(0.3f);
+  tick(speed_control, 20);
+  check(speed_control.get_speed_m_per_s() > 0.1f,
+        "estimate rises although the last pulse is long ago");
+  check(fake::mcpwm_compare_value() < 480, "duty eases off as the estimate rises");
+
+  // no pulse after the estimate passed a pulse distance, the wheel stalls
+  tick(speed_control, 100);
+  check(speed_control.get_speed_m_per_s() < 0.05f, "stalled train estimated standing");
+}
+
+void test_position_mode_stops_at_target() {
+  drive::SpeedControl speed_control;
+  speed_control.set_ref_speed_m_per_s(0.3f);
+  // two pulses of the 6 cm wheel
+  speed_control.set_target_distance_m(0.12f);
+
+  tick(speed_control, 1);
+  check(fake::mcpwm_compare_value() > zero_duty_compare, "drives towards the target");
+
+  // 0.3 m/s, braking towards the mark may reverse the duty
+  bool arrived = false;
+  for (int i = 2; i <= 400 && !arrived; ++i) {
+    tick(speed_control, 1);
+    arrived = speed_control.get_distance_m() >= 0.12f;
+    if (i % 20 == 0) {
+      fake::gpio_edge(tacho_gpio);
+    }
+  }
+  check(arrived, "target reached");
+  check(fake::mcpwm_compare_value() == zero_duty_compare, "zero duty at the mark");
+  tick(speed_control, 50);
+  check(fake::mcpwm_compare_value() == zero_duty_compare, "no creeping past the mark");
+
+  speed_control.set_target_distance_m(0.06f);
+  tick(speed_control, 1);
+  check(fake::mcpwm_compare_value() > zero_duty_compare,
+        "next target drives at the kept cruise speed");
+}
+
+}  // namespace
+
+int main() {
+  test_pid_clamps_without_windup();
+  test_supply_compensation();
+  test_period_change_rescales_compare();
+  test_static_variant_matches_runtime();
+  test_observer_saturates();
+  test_backward_drive_and_braking();
+  test_start_from_standstill();
+  test_position_mode_stops_at_target();
+
+  std::printf("speed control: %d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,13 +3,15 @@
 /// @copyright GPL v2.0
 
 #include <array>
-#include <string>
+#include <string_view>
 #include <variant>
 
 #include "hal/gpio_types.h"
 #include "host/ble_gap.h"
 #include "host/ble_gatt.h"
+#include "host/ble_hs_adv.h"
 #include "host/ble_uuid.h"
+#include "latency.hpp"
 #include "services/gatt/ble_svc_gatt.h"
 
 namespace ble {
@@ -75,23 +77,42 @@ class Ble {
   };
 
   /// @brief constructor
-  /// @param device_name advertizing name of device
+  /// @param device_name advertizing name of device, at most max_device_name_length characters
   /// @param _external_event_handler event handler for gap. needs to be staticall defined. use ble's
   /// @param services services proveded by ble
   /// @param antenna choose which antenna to use
-  Ble(std::string _device_name, ble_gap_event_fn *_external_event_handler,
+  Ble(std::string_view _device_name, ble_gap_event_fn *_external_event_handler,
       ble_gatt_svc_def *services, Antenna antenna = Antenna::internal);
 
   ~Ble();
 
+  /// advertizing data besides the name, each field with a length and a type byte: flags (1),
+  /// tx power (1), appearance (2) and le role (1). see adv_fields
+  constexpr static inline size_t adv_fields_size = (2 + 1) + (2 + 1) + (2 + 2) + (2 + 1);
+
+  /// longest name that fits into the advertizing data next to adv_fields_size and the header
+  /// of the name field
+  constexpr static inline size_t max_device_name_length =
+      BLE_HS_ADV_MAX_SZ - adv_fields_size - 2;
+
   /// @brief nimble base task
   void nimble_host_task();
 
-  /// @brief handles gap events
-  void event_handler(ble_gap_event *event);
+  /// @brief handles gap events. runs in nimble host task and never throws
+  /// @return result for the nimble host, nonzero if the event could not be handled
+  int event_handler(ble_gap_event *event);
+
+  /// @return handling time of gap events in event_handler
+  trace::Histogram::Summary event_statistics() const { return event_latency.summary(); }
 
   /// start advertizing on demand. stops when connection is established
-  void start_advertising();
+  /// @return false if advertizing could not be started, true if it runs already
+  bool start_advertising();
+
+  /// start advertizing, resetting the host if that fails. without advertizing no peer could
+  /// connect again, the host syncs anew after the reset and the sync callback retries
+  /// @return false if advertizing could not be started and the host reset is scheduled
+  bool start_advertising_or_reset();
 
   /// stop current advertizing in progress
   void stop_advertizing();
@@ -105,9 +126,11 @@ class Ble {
   constexpr static inline std::string_view esp_uri = "\x17//espressif.com";
   uint8_t own_addr_type = 0;
   uint8_t addr_val[6] = {0};
-  std::string device_name;
+  std::array<char, max_device_name_length + 1> device_name = {0};
   ble_gap_event_fn *external_event_handler;
+  trace::Histogram event_latency;
 
+  /// every field added here has to be counted in adv_fields_size
   ble_hs_adv_fields adv_fields = {
       .flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP,
 
@@ -145,9 +168,7 @@ class Ble {
       .itvl_max = BLE_GAP_ADV_ITVL_MS(510),
   };
 
-  void init_nvs();
-
-  void init_gap(std::string _device_name);
+  void init_gap(std::string_view _device_name);
 
   void init_nimble_hci();
 
@@ -0,0 +1,192 @@
+/** @file latency.hpp
+ * @brief latency instrumentation from a ble command to the motor duty update
+ * @author tomatenkuchen
+ * @date 2026-10-18
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+namespace trace {
+
+#ifdef CONFIG_TRAIN_LATENCY_TRACE
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+/// @brief histogram of durations in microseconds with four buckets per octave.
+/// written by one task, may be read from any other
+class Histogram {
+public:
+  struct Summary {
+    uint32_t count;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+  };
+
+  /// @brief add a duration
+  /// @param us duration in microseconds
+  void add(uint32_t us);
+
+  /// @return number of samples, percentiles (bucket upper bound) and maximum
+  Summary summary() const;
+
+private:
+  constexpr static uint32_t sub_buckets = 4;
+  /// durations beyond 2^max_octave us are counted in the last bucket
+  constexpr static uint32_t max_octave = 24;
+  constexpr static uint32_t bucket_count = sub_buckets * (max_octave - 1);
+
+  static uint32_t bucket_index(uint32_t us);
+  static uint32_t bucket_upper_us(uint32_t index);
+  uint32_t percentile_us(uint32_t count, uint32_t percent) const;
+
+  std::array<std::atomic<uint32_t>, bucket_count> buckets{};
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> max_us{0};
+};
+
+inline uint32_t Histogram::bucket_index(uint32_t us) {
+  us = std::min(us, (uint32_t{1} << max_octave) - 1);
+  if (us < sub_buckets) {
+    return us;
+  }
+  uint32_t const octave = std::bit_width(us) - 1;
+  uint32_t const sub = (us >> (octave - 2)) & (sub_buckets - 1);
+  return sub_buckets * (octave - 1) + sub;
+}
+
+inline uint32_t Histogram::bucket_upper_us(uint32_t index) {
+  if (index < sub_buckets) {
+    return index;
+  }
+  uint32_t const octave = index / sub_buckets + 1;
+  uint32_t const sub = index % sub_buckets;
+  uint32_t const width = uint32_t{1} << (octave - 2);
+  return (sub_buckets + sub) * width + width - 1;
+}
+
+inline void Histogram::add(uint32_t us) {
+  auto &bucket = buckets[bucket_index(us)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (us > max_us.load(std::memory_order_relaxed)) {
+    max_us.store(us, std::memory_order_relaxed);
+  }
+}
+
+inline uint32_t Histogram::percentile_us(uint32_t total, uint32_t percent) const {
+  uint64_t const target = (uint64_t{total} * percent + 99) / 100;
+  uint64_t cumulated = 0;
+  for (uint32_t i = 0; i < bucket_count; ++i) {
+    cumulated += buckets[i].load(std::memory_order_relaxed);
+    if (cumulated >= target) {
+      return bucket_upper_us(i);
+    }
+  }
+  return bucket_upper_us(bucket_count - 1);
+}
+
+inline Histogram::Summary Histogram::summary() const {
+  uint32_t const total = count.load(std::memory_order_relaxed);
+  if (total == 0) {
+    return {};
+  }
+  return {
+      .count = total,
+      .p50_us = percentile_us(total, 50),
+      .p99_us = percentile_us(total, 99),
+      .max_us = max_us.load(std::memory_order_relaxed),
+  };
+}
+
+/// @brief timestamps a command on its way from the gatt access callback
+/// (ble host task) through the hand over to the control loop to the duty
+/// update, all on the esp_timer time base
+class CommandLatency {
+public:
+  enum class Segment : uint8_t {
+    access_to_handoff,
+    handoff_to_applied,
+    total,
+  };
+
+  /// @brief ble host task: command was accepted in gatt access callback. call
+  /// only for commands handed to the control loop, so reads and rejected
+  /// writes do not leave a stamp the next handoff would be measured against
+  void on_access();
+
+  /// @brief control task: command taken over by control loop
+  void on_handoff();
+
+  /// @brief control task: duty computed with the command was applied
+  void on_applied();
+
+  /// @return latency statistics of one segment of the command path
+  Histogram::Summary summary(Segment segment) const;
+
+private:
+  static uint32_t now_us() { return static_cast<uint32_t>(esp_timer_get_time()); }
+
+  std::atomic<uint32_t> access_us{0};
+  std::atomic<bool> access_pending{false};
+  /// owned by control task
+  uint32_t handoff_access_us = 0;
+  uint32_t handoff_us = 0;
+  bool handoff_pending = false;
+  std::array<Histogram, 3> histograms;
+};
+
+inline void CommandLatency::on_access() {
+  if constexpr (!enabled) {
+    return;
+  }
+  access_us.store(now_us(), std::memory_order_relaxed);
+  access_pending.store(true, std::memory_order_release);
+}
+
+inline void CommandLatency::on_handoff() {
+  if constexpr (!enabled) {
+    return;
+  }
+  if (!access_pending.exchange(false, std::memory_order_acquire)) {
+    return;
+  }
+  handoff_us = now_us();
+  handoff_access_us = access_us.load(std::memory_order_relaxed);
+  handoff_pending = true;
+  histograms[static_cast<uint8_t>(Segment::access_to_handoff)].add(handoff_us -
+                                                                  handoff_access_us);
+}
+
+inline void CommandLatency::on_applied() {
+  if constexpr (!enabled) {
+    return;
+  }
+  if (!handoff_pending) {
+    return;
+  }
+  handoff_pending = false;
+  uint32_t const applied_us = now_us();
+  histograms[static_cast<uint8_t>(Segment::handoff_to_applied)].add(applied_us - handoff_us);
+  histograms[static_cast<uint8_t>(Segment::total)].add(applied_us - handoff_access_us);
+}
+
+inline Histogram::Summary CommandLatency::summary(Segment segment) const {
+  return histograms[static_cast<uint8_t>(segment)].summary();
+}
+
+/// latency of commands from ble to motor
+inline CommandLatency command_latency;
+
+}  // namespace trace
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+
 #include "driver/gpio.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "led_strip.h"
 #include "sdkconfig.h"
+#include "swap_buffer.hpp"
 
 namespace led {
 
@@ -16,4 +25,90 @@ class Led {
   gpio_num_t pin;
 };
 
+/// @brief head and tail lights on an addressable led strip. frames are rendered
+/// by a timer into a preallocated buffer and handed to a low priority refresh
+/// task when they change, so lighting stays off the control loop and the
+/// esp_timer task. holds the refresh task stack, give it static storage
+class Lighting {
+ public:
+  /// longest strip the frame buffer is sized for
+  constexpr static inline uint32_t max_led_count = 32;
+
+  struct Config {
+    /// data pin of the strip
+    gpio_num_t pin;
+    /// number of leds on the strip
+    uint32_t led_count;
+    /// leds at the start of the strip, lit as head lights when driving forward
+    uint32_t front_count;
+    /// leds at the end of the strip, lit as head lights when driving backward
+    uint32_t back_count;
+    /// time between two rendered frames
+    uint32_t frame_period_ms;
+  };
+
+  Lighting(Config const &_cfg);
+  ~Lighting();
+
+  Lighting(Lighting const &) = delete;
+  Lighting &operator=(Lighting const &) = delete;
+
+  /// @brief motion state the lights follow. cheap, may be called from any task
+  /// @param speed_m_per_s signed speed, negative values mean driving backward. non finite
+  /// values are ignored
+  void set_speed_m_per_s(float speed_m_per_s);
+
+ private:
+  struct Rgb {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+
+    bool operator==(Rgb const &) const = default;
+  };
+
+  using Frame = std::array<Rgb, max_led_count>;
+
+  /// speed below which the train counts as standing
+  constexpr static inline float standstill_m_per_s = 0.01f;
+  /// speed at which the head lights reach full brightness
+  constexpr static inline float full_beam_m_per_s = 0.5f;
+
+  /// sending a frame waits for the strip transfer, below every other task
+  constexpr static inline UBaseType_t refresh_task_priority = 1;
+  constexpr static inline uint32_t refresh_task_stack_size = 2048;
+
+  static void on_frame_timer(void *arg);
+
+  static void refresh_task(void *arg);
+
+  void render();
+
+  void fill(uint32_t first, uint32_t count, Rgb color);
+
+  /// @brief timer side: hands a changed frame to the refresh task
+  void publish();
+
+  /// @brief refresh task side: writes a frame to the strip
+  void send(Frame const &_frame);
+
+  Config cfg;
+  led_strip_handle_t strip;
+  esp_timer_handle_t frame_timer;
+  std::atomic<float> speed_m_per_s = 0;
+  /// last driving direction, kept while standing
+  bool forward = true;
+  uint32_t frame_count = 0;
+  /// owned by frame timer
+  Frame frame = {};
+  Frame published_frame = {};
+  util::SwapBuffer<Frame> frames;
+  /// held while the strip is written, so it is not deleted under a transfer
+  SemaphoreHandle_t strip_mutex;
+  StaticSemaphore_t strip_mutex_buffer;
+  TaskHandle_t refresh_task_handle;
+  StaticTask_t refresh_task_buffer;
+  StackType_t refresh_task_stack[refresh_task_stack_size];
+};
+
 }  // namespace led
@@ -0,0 +1,126 @@
+/** @file observer.hpp
+ * @brief fixed point kalman filter estimating speed of a dc motor drive
+ * @author tomatenkuchen
+ * @date 2026-10-18
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+namespace sig {
+
+/// @brief estimates speed between sparse measurements with a first order dc
+/// motor model driven by the applied duty. all state is q16.16 fixed point,
+/// an update costs a handful of multiplies and one division
+class SpeedObserver {
+public:
+  struct Config {
+    /// mechanical time constant of the drive in seconds
+    float time_constant_s;
+    /// time between two predict calls in seconds
+    float tick_period_s;
+    /// steady state speed at full duty in meter per second
+    float speed_at_full_duty_m_per_s;
+    /// variance added to the estimate by every prediction in (m/s)^2
+    float process_noise;
+    /// variance of a speed measurement in (m/s)^2
+    float measurement_noise;
+  };
+
+  /// fractional bits of the fixed point values
+  constexpr static int frac_bits = 16;
+
+  /// @brief constructs observer by config
+  /// @param cfg configuration, converted to fixed point once
+  SpeedObserver(Config const &cfg);
+
+  /// @brief advance the model by one tick
+  /// @param duty_q16 applied duty, -1..1 in q16.16
+  void predict(int32_t duty_q16);
+
+  /// @brief fuse a speed measurement into the estimate
+  /// @param speed_m_per_s measured speed
+  void correct(float speed_m_per_s);
+
+  /// @brief caps the estimate, e.g. by the speed still possible without a
+  /// new measurement
+  /// @param max_speed_m_per_s largest plausible absolute speed
+  void limit(float max_speed_m_per_s);
+
+  /// @return estimated speed
+  float speed_m_per_s() const;
+
+private:
+  /// largest magnitude of a q16.16 value
+  constexpr static float max_value =
+      std::numeric_limits<int32_t>::max() >> frac_bits;
+
+  /// @return value in q16.16, saturated to +-max_value, nan maps to 0
+  static int32_t to_fixed(float value);
+  static int32_t mul(int32_t a, int32_t b);
+
+  /// speed decay per tick
+  int32_t decay;
+  /// speed gain of duty per tick
+  int32_t gain;
+  int32_t process_noise;
+  int32_t measurement_noise;
+  /// estimated speed
+  int32_t speed = 0;
+  /// variance of the estimate
+  int32_t variance;
+};
+
+inline SpeedObserver::SpeedObserver(SpeedObserver::Config const &cfg)
+    : decay{to_fixed(std::exp(-cfg.tick_period_s / cfg.time_constant_s))},
+      gain{to_fixed(cfg.speed_at_full_duty_m_per_s *
+                    (1 - std::exp(-cfg.tick_period_s / cfg.time_constant_s)))},
+      process_noise{to_fixed(cfg.process_noise)},
+      measurement_noise{to_fixed(cfg.measurement_noise)},
+      variance{to_fixed(cfg.measurement_noise)} {}
+
+inline int32_t SpeedObserver::to_fixed(float value) {
+  if (std::isnan(value)) {
+    return 0;
+  }
+  return static_cast<int32_t>(
+      std::lround(std::clamp(value, -max_value, max_value) * (1 << frac_bits)));
+}
+
+inline int32_t SpeedObserver::mul(int32_t a, int32_t b) {
+  return static_cast<int32_t>((static_cast<int64_t>(a) * b) >> frac_bits);
+}
+
+inline void SpeedObserver::predict(int32_t duty_q16) {
+  speed = mul(decay, speed) + mul(gain, duty_q16);
+  variance = mul(mul(decay, decay), variance) + process_noise;
+}
+
+inline void SpeedObserver::correct(float speed_m_per_s) {
+  // the difference of two saturated values needs 33 bits
+  int64_t const innovation = int64_t{to_fixed(speed_m_per_s)} - speed;
+  int32_t const kalman_gain = static_cast<int32_t>(
+      (static_cast<int64_t>(variance) << frac_bits) /
+      (static_cast<int64_t>(variance) + measurement_noise));
+  // the gain is at most one, the result lies between estimate and measurement
+  speed += static_cast<int32_t>((kalman_gain * innovation) >> frac_bits);
+  variance = mul((1 << frac_bits) - kalman_gain, variance);
+}
+
+inline void SpeedObserver::limit(float max_speed_m_per_s) {
+  int32_t const max_speed = to_fixed(max_speed_m_per_s);
+  if (std::abs(speed) > max_speed) {
+    speed = speed < 0 ? -max_speed : max_speed;
+  }
+}
+
+inline float SpeedObserver::speed_m_per_s() const {
+  return static_cast<float>(speed) / (1 << frac_bits);
+}
+
+}; // namespace sig
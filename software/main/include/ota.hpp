@@ -0,0 +1,98 @@
+/// @file ota.hpp
+/// @brief firmware update over bluetooth low energy
+/// @copyright GPL v2.0
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+
+#include "esp_ota_ops.h"
+#include "host/ble_gatt.h"
+#include "host/ble_hs.h"
+#include "ota_transfer.hpp"
+
+namespace ota {
+
+/// @brief cancels the rollback of a freshly updated image. the bootloader boots the previous
+/// image again if the new one resets before this is called
+void confirm_running_image();
+
+/// streams image chunks into the inactive ota partition. flash is erased sector by sector while
+/// writing, so no call blocks the ble host for the erase of the whole partition
+class FlashSink {
+ public:
+  bool begin(uint32_t image_size);
+  bool write(std::span<uint8_t const> data);
+  bool end();
+  void abort();
+
+ private:
+  esp_partition_t const *partition = nullptr;
+  esp_ota_handle_t handle = 0;
+};
+
+/// @brief ble front end of the firmware transfer
+///
+/// control characteristic (write, notify):
+/// - begin: 0x01, uint32 image size, uint8 window
+/// - end: 0x02, 32 byte sha256 of the image
+///
+/// data characteristic (write without response): uint16 sequence, payload
+///
+/// notifications on the control characteristic: uint8 Transfer::Reply,
+/// uint16 next sequence, uint32 bytes received, uint32 bytes per second.
+/// all values little endian
+///
+/// a transfer only begins on an encrypted link to a bonded peer and takes data from that
+/// connection only, until end or the disconnect. images are checked against the sha256 sent with end, they are not signed
+class Updater {
+ public:
+  /// @param _notify_handle value handle of the control characteristic
+  Updater(uint16_t const *_notify_handle);
+
+  /// handle a write to the control characteristic
+  /// @return att error code, 0 on success
+  int on_control(uint16_t conn_handle, ble_gatt_access_ctxt *ctxt);
+
+  /// handle a write to the data characteristic
+  /// @return att error code, 0 on success
+  int on_data(uint16_t conn_handle, ble_gatt_access_ctxt *ctxt);
+
+  /// abort the transfer started on the connection, a later link with the same handle must not
+  /// continue it
+  void on_disconnect(uint16_t conn_handle);
+
+  /// @return true if a verified image waits for a restart. may be called from any task
+  bool restart_pending() const { return image_ready.load(std::memory_order_acquire); }
+
+ private:
+  enum class Command : uint8_t {
+    begin = 0x01,
+    end = 0x02,
+  };
+
+  using Response = Transfer<FlashSink>::Response;
+
+  void notify(uint16_t conn_handle, Response const &response);
+
+  /// @return true if the link is encrypted and the peer bonded
+  static bool trusted(uint16_t conn_handle);
+
+  uint32_t bytes_per_s() const;
+
+  uint16_t const *notify_handle;
+  FlashSink sink;
+  Transfer<FlashSink> transfer;
+  int64_t start_us = 0;
+  /// connection the running transfer was started on
+  uint16_t transfer_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+  /// written by the ble host task, polled by the heart beat in app_main
+  std::atomic<bool> image_ready = false;
+  /// fits a chunk at the largest att mtu
+  std::array<uint8_t, 512> buffer;
+};
+
+}  // namespace ota
@@ -0,0 +1,156 @@
+/** @file ota_transfer.hpp
+ * @brief chunked firmware transfer with windowed acknowledgement and running hash
+ * @author tomatenkuchen
+ * @date 2026-10-18
+ *
+ * free of esp-idf dependencies besides mbedtls so it builds on the host too
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "mbedtls/sha256.h"
+
+namespace ota {
+
+using Hash = std::array<uint8_t, 32>;
+
+/// @brief reassembles an image from sequence numbered chunks and streams it to
+/// a sink. Sink needs begin(uint32_t size), write(std::span<uint8_t const>),
+/// end() returning bool and abort()
+template <typename Sink> class Transfer {
+public:
+  enum class Reply : uint8_t {
+    /// all chunks up to next_sequence received
+    ack = 0x80,
+    /// chunk out of order, resend from next_sequence
+    nak = 0x81,
+    /// image complete and verified
+    done = 0x82,
+    /// transfer aborted
+    error = 0x83,
+  };
+
+  struct Response {
+    Reply reply;
+    uint16_t next_sequence;
+    uint32_t received;
+  };
+
+  Transfer(Sink &_sink) : sink{_sink} { mbedtls_sha256_init(&sha); }
+
+  ~Transfer() {
+    abort();
+    mbedtls_sha256_free(&sha);
+  }
+
+  /// @brief starts a new transfer, aborting one in progress
+  /// @param _image_size size of complete image in bytes
+  /// @param _window chunks the client sends before it waits for an ack
+  /// @return false if sink could not be prepared
+  bool begin(uint32_t _image_size, uint8_t _window);
+
+  /// @brief process one chunk
+  /// @return reply to send to the client if any
+  std::optional<Response> on_chunk(uint16_t sequence, std::span<uint8_t const> data);
+
+  /// @brief verifies hash of the complete image and finalizes the sink
+  Response finish(Hash const &expected);
+
+  /// @brief drops the transfer in progress
+  void abort();
+
+  bool active() const { return running; }
+
+  uint32_t received() const { return received_bytes; }
+
+private:
+  Response response(Reply reply) const { return {reply, next_sequence, received_bytes}; }
+
+  Sink &sink;
+  mbedtls_sha256_context sha;
+  bool running = false;
+  /// a nak was sent and the client has not resent the missing chunk yet
+  bool nak_pending = false;
+  uint8_t window = 1;
+  uint8_t chunks_in_window = 0;
+  uint16_t next_sequence = 0;
+  uint32_t image_size = 0;
+  uint32_t received_bytes = 0;
+};
+
+template <typename Sink> bool Transfer<Sink>::begin(uint32_t _image_size, uint8_t _window) {
+  abort();
+  if (_image_size == 0 || _window == 0 || !sink.begin(_image_size)) {
+    return false;
+  }
+  mbedtls_sha256_starts(&sha, 0);
+  image_size = _image_size;
+  window = _window;
+  chunks_in_window = 0;
+  next_sequence = 0;
+  received_bytes = 0;
+  nak_pending = false;
+  running = true;
+  return true;
+}
+
+template <typename Sink>
+std::optional<typename Transfer<Sink>::Response>
+Transfer<Sink>::on_chunk(uint16_t sequence, std::span<uint8_t const> data) {
+  if (!running) {
+    return response(Reply::error);
+  }
+
+  if (sequence != next_sequence) {
+    // chunks behind a gap are dropped, the client goes back to next_sequence
+    if (nak_pending) {
+      return std::nullopt;
+    }
+    nak_pending = true;
+    return response(Reply::nak);
+  }
+  nak_pending = false;
+
+  if (data.size() > image_size - received_bytes || !sink.write(data)) {
+    abort();
+    return response(Reply::error);
+  }
+  mbedtls_sha256_update(&sha, data.data(), data.size());
+  received_bytes += data.size();
+  ++next_sequence;
+
+  if (++chunks_in_window >= window || received_bytes == image_size) {
+    chunks_in_window = 0;
+    return response(Reply::ack);
+  }
+  return std::nullopt;
+}
+
+template <typename Sink> typename Transfer<Sink>::Response Transfer<Sink>::finish(Hash const &expected) {
+  if (!running || received_bytes != image_size) {
+    abort();
+    return response(Reply::error);
+  }
+  Hash actual;
+  mbedtls_sha256_finish(&sha, actual.data());
+  running = false;
+  if (actual != expected) {
+    sink.abort();
+    return response(Reply::error);
+  }
+  return response(sink.end() ? Reply::done : Reply::error);
+}
+
+template <typename Sink> void Transfer<Sink>::abort() {
+  if (running) {
+    sink.abort();
+    running = false;
+  }
+}
+
+}  // namespace ota
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 namespace sig {
 
 /// @brief PID controller class for signal control
@@ -28,9 +30,12 @@ public:
   /// @param cfg configuration
   PIDController(Config const &cfg);
 
-  /// @brief feed new control error to controller and calculate response
+  /// @brief feed new control error to controller and calculate response.
+  /// the integrator holds while the output is saturated in the direction it
+  /// would integrate, so it does not wind up
   /// @param input new control error input
-  /// @return controller output (sometimes shown as y in literature)
+  /// @return controller output (sometimes shown as y in literature), clamped
+  /// to limit_min..limit_max
   T update(T input);
 
   /// @brief resets state in controller
@@ -40,6 +45,10 @@ public:
   /// @return current value of integrator state without new input
   T value() const;
 
+  /// @brief replaces configuration but keeps controller state
+  /// @param cfg new configuration
+  void configure(Config const &cfg);
+
 private:
   /// integrator state
   mutable T i_state = 0;
@@ -56,12 +65,17 @@ PIDController<T>::PIDController(PIDController<T>::Config const &_cfg)
 template <typename T> T PIDController<T>::update(T input) {
   auto const out_p = cfg.amp_p * input;
 
-  i_state += cfg.amp_i * input;
-
   auto const out_d = (input - d_state) * cfg.amp_d;
   d_state = input;
 
-  return out_p + out_d + i_state;
+  auto const i_step = cfg.amp_i * input;
+  auto const out = out_p + out_d + i_state + i_step;
+  if (!(out > cfg.limit_max && i_step > 0) &&
+      !(out < cfg.limit_min && i_step < 0)) {
+    i_state += i_step;
+  }
+
+  return std::clamp(out_p + out_d + i_state, cfg.limit_min, cfg.limit_max);
 }
 
 template <typename T> void PIDController<T>::reset(T init) {
@@ -71,4 +85,9 @@ template <typename T> void PIDController<T>::reset(T init) {
 
 template <typename T> T PIDController<T>::value() const { return i_state; }
 
+template <typename T>
+void PIDController<T>::configure(PIDController<T>::Config const &_cfg) {
+  cfg = _cfg;
+}
+
 }; // namespace sig
@@ -3,17 +3,32 @@
 /// @author tomatenkuchen
 /// @copyright GPLv2.0
 
+#include "driver/gpio.h"
 #include "driver/gptimer.h"
 #include "driver/mcpwm_cmpr.h"
+#include "driver/mcpwm_gen.h"
 #include "driver/mcpwm_oper.h"
 #include "driver/mcpwm_timer.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_oneshot.h"
+#include "latency.hpp"
+#include "observer.hpp"
 #include "pid.hpp"
+#include "sdkconfig.h"
+#include "swap_buffer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <limits>
 #include <stdexcept>
 
 namespace drive {
 
+/// @brief odometry and speed from tacho pulses. on_tacho_event runs in the
+/// tacho isr and publishes a snapshot, the control task takes it over with
+/// update and reads it with the getters
 class MeasureSpeed {
 
 public:
@@ -22,61 +37,262 @@ public:
     float wheel_circumpherance_m;
     /// timer handle
     gptimer_config_t timer_cfg;
+    /// input of the tacho sensor, one rising edge per pulse
+    gpio_num_t tacho_gpio;
   };
 
-  MeasureSpeed(Config const &_cfg) : cfg{_cfg} {
+  MeasureSpeed(Config const &_cfg)
+      : cfg{_cfg}, wheel_circumpherance_m{_cfg.wheel_circumpherance_m} {
     if (gptimer_new_timer(&cfg.timer_cfg, &timer_handle) != ESP_OK) {
       throw std::runtime_error("measure speed: timer init failed");
     }
     gptimer_enable(timer_handle);
     gptimer_start(timer_handle);
-    gptimer_get_raw_count(timer_handle, &timestamp_latest_tacho_event);
+    gptimer_get_raw_count(timer_handle, &isr_tacho.timestamp);
+    tacho = isr_tacho;
   }
 
   ~MeasureSpeed() {
+    if (tacho_attached) {
+      gpio_isr_handler_remove(cfg.tacho_gpio);
+    }
     gptimer_stop(timer_handle);
     gptimer_disable(timer_handle);
     gptimer_del_timer(timer_handle);
   }
 
-  /// execute this function on a tacho event
+  /// @brief routes rising edges of the tacho input to on_edge
+  /// @param on_edge isr handler, has to end up in on_tacho_event
+  /// @param arg argument for on_edge
+  void attach_tacho(gpio_isr_t on_edge, void *arg) {
+    gpio_config_t const tacho_io = {
+        .pin_bit_mask = 1ULL << cfg.tacho_gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    // the isr service may already be installed by another driver
+    esp_err_t const service = gpio_install_isr_service(0);
+    if (gpio_config(&tacho_io) != ESP_OK ||
+        (service != ESP_OK && service != ESP_ERR_INVALID_STATE) ||
+        gpio_isr_handler_add(cfg.tacho_gpio, on_edge, arg) != ESP_OK) {
+      throw std::runtime_error("measure speed: tacho init failed");
+    }
+    tacho_attached = true;
+  }
+
+  /// execute this function on a tacho event. isr context
   void on_tacho_event() {
+    float const circumpherance_m =
+        wheel_circumpherance_m.load(std::memory_order_relaxed);
+    uint64_t const delta_count = take_tacho_delta();
+    isr_tacho.speed_m_per_s =
+        circumpherance_m * cfg.timer_cfg.resolution_hz / delta_count;
+    isr_tacho.distance_m += circumpherance_m;
+    publish_tacho();
+  }
+
+  /// @brief control task: takes over the latest tacho snapshot
+  void update() {
+    if (Tacho const *latest = tachos.consume()) {
+      tacho = *latest;
+    }
+  }
+
+  float get_speed_m_per_s() const { return tacho.speed_m_per_s; }
+
+  /// @return distance travelled since construction in meter
+  float get_distance_m() const { return tacho.distance_m; }
+
+  /// @return number of tacho events since construction
+  uint32_t get_pulse_count() const { return tacho.pulse_count; }
+
+  /// @return distance travelled between two tacho events in meter
+  float get_distance_per_pulse_m() const {
+    return wheel_circumpherance_m.load(std::memory_order_relaxed);
+  }
+
+  /// @return highest speed that is possible without a tacho event so far
+  float get_speed_bound_m_per_s() const {
+    return wheel_circumpherance_m.load(std::memory_order_relaxed) *
+           cfg.timer_cfg.resolution_hz / ticks_since_tacho_event();
+  }
+
+  /// @param circumpherance_m new circumpherance of propulsion wheel
+  void set_wheel_circumpherance_m(float circumpherance_m) {
+    wheel_circumpherance_m.store(circumpherance_m, std::memory_order_relaxed);
+  }
+
+protected:
+  /// state of the tacho after a pulse
+  struct Tacho {
+    float speed_m_per_s = 0;
+    /// odometry, accumulated per tacho pulse
+    float distance_m = 0;
+    uint64_t timestamp = 0;
+    uint32_t pulse_count = 0;
+  };
+
+  /// @return timer ticks since the previous tacho event. isr context
+  uint64_t take_tacho_delta() {
     uint64_t new_count;
     gptimer_get_raw_count(timer_handle, &new_count);
-    uint64_t const delta_count = new_count - timestamp_latest_tacho_event;
-    speed_m_per_s =
-        cfg.wheel_circumpherance_m * cfg.timer_cfg.resolution_hz / delta_count;
-    timestamp_latest_tacho_event = new_count;
+    uint64_t const delta_count =
+        std::max<uint64_t>(new_count - isr_tacho.timestamp, 1);
+    isr_tacho.timestamp = new_count;
+    ++isr_tacho.pulse_count;
+    return delta_count;
   }
 
-  float get_speed_m_per_s() const { return speed_m_per_s; }
+  /// @brief hands the isr state to the control task. isr context
+  void publish_tacho() {
+    tachos.shadow() = isr_tacho;
+    tachos.publish();
+  }
+
+  /// @return timer ticks since the latest tacho event, at least one
+  uint64_t ticks_since_tacho_event() const {
+    uint64_t count;
+    gptimer_get_raw_count(timer_handle, &count);
+    return std::max<uint64_t>(count - tacho.timestamp, 1);
+  }
 
-private:
   Config cfg;
+  /// written by the control task, read in the isr
+  std::atomic<float> wheel_circumpherance_m;
   gptimer_handle_t timer_handle;
-  float speed_m_per_s = 0;
-  uint64_t timestamp_latest_tacho_event = 0;
+  bool tacho_attached = false;
+  /// owned by the isr
+  Tacho isr_tacho;
+  util::SwapBuffer<Tacho> tachos;
+  /// owned by the control task
+  Tacho tacho;
+};
+
+class BatteryMonitor {
+
+public:
+  struct Config {
+    /// adc unit the battery divider is connected to
+    adc_unit_t unit;
+    /// adc channel the battery divider is connected to
+    adc_channel_t channel;
+    /// ratio of battery voltage to adc pin voltage given by the resistor divider
+    float divider_ratio;
+    /// weight of a new sample in the low pass filter, 0 < weight <= 1
+    float filter_weight;
+  };
+
+  BatteryMonitor(Config const &_cfg) : cfg{_cfg} {
+    adc_oneshot_unit_init_cfg_t const unit_cfg = {.unit_id = cfg.unit};
+    if (adc_oneshot_new_unit(&unit_cfg, &adc_handle) != ESP_OK) {
+      throw std::runtime_error("battery monitor: adc init failed");
+    }
+    // the divider keeps the pin below 1 V, the adc is most accurate there
+    // without attenuation
+    adc_oneshot_chan_cfg_t const channel_cfg = {
+        .atten = ADC_ATTEN_DB_0,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    if (adc_oneshot_config_channel(adc_handle, cfg.channel, &channel_cfg) !=
+        ESP_OK) {
+      throw std::runtime_error("battery monitor: adc channel config failed");
+    }
+    adc_cali_curve_fitting_config_t const cali_cfg = {
+        .unit_id = cfg.unit,
+        .chan = cfg.channel,
+        .atten = ADC_ATTEN_DB_0,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &cali_handle) !=
+        ESP_OK) {
+      throw std::runtime_error("battery monitor: adc calibration failed");
+    }
+  }
+
+  ~BatteryMonitor() {
+    adc_cali_delete_scheme_curve_fitting(cali_handle);
+    adc_oneshot_del_unit(adc_handle);
+  }
+
+  /// take a new sample of the battery voltage. call this periodically
+  void sample() {
+    int raw;
+    int pin_mv;
+    if (adc_oneshot_read(adc_handle, cfg.channel, &raw) != ESP_OK ||
+        adc_cali_raw_to_voltage(cali_handle, raw, &pin_mv) != ESP_OK) {
+      // keep last valid voltage
+      return;
+    }
+    float const new_voltage_v = pin_mv * 1e-3f * cfg.divider_ratio;
+    if (voltage_v == 0) {
+      voltage_v = new_voltage_v;
+    } else {
+      voltage_v += cfg.filter_weight * (new_voltage_v - voltage_v);
+    }
+  }
+
+  /// @return filtered battery voltage, 0 if not yet sampled
+  float get_voltage_v() const { return voltage_v; }
+
+private:
+  Config cfg;
+  adc_oneshot_unit_handle_t adc_handle;
+  adc_cali_handle_t cali_handle;
+  float voltage_v = 0;
 };
 
+/// @brief drives the dc motor between two half bridges of the motor driver in
+/// locked antiphase: bridge a follows the pwm, bridge b its inverse. half the
+/// period is zero duty
 class MotorControl {
 public:
   struct Config {
     mcpwm_timer_config_t timer_cfg;
     mcpwm_operator_config_t operator_cfg;
     mcpwm_comparator_config_t comparator_cfg;
+    /// input of the half bridge on the first motor terminal
+    gpio_num_t bridge_a_gpio;
+    /// input of the half bridge on the second motor terminal
+    gpio_num_t bridge_b_gpio;
+    /// open drain enable of the driver, pulled low by the driver on a fault
+    gpio_num_t enable_gpio;
+    /// standby input of the driver, low active
+    gpio_num_t standby_gpio;
+    /// supply voltage the duty is referenced to. 0 disables compensation
+    float nominal_supply_v;
   };
 
   MotorControl(Config const &_cfg) : cfg{_cfg} {
-    mcpwm_new_timer(&cfg.timer_cfg, &timer_handle);
-    mcpwm_new_operator(&cfg.operator_cfg, &operator_handle);
-    mcpwm_operator_connect_timer(operator_handle, timer_handle);
-    mcpwm_new_comparator(operator_handle, &cfg.comparator_cfg,
-                         &comparator_handle);
-    mcpwm_comparator_set_compare_value(comparator_handle, 0);
-    mcpwm_timer_start_stop(timer_handle, MCPWM_TIMER_START_NO_STOP);
+    check(mcpwm_new_timer(&cfg.timer_cfg, &timer_handle),
+          "motor control: timer init failed");
+    check(mcpwm_new_operator(&cfg.operator_cfg, &operator_handle),
+          "motor control: operator init failed");
+    check(mcpwm_operator_connect_timer(operator_handle, timer_handle),
+          "motor control: operator connect init failed");
+    check(mcpwm_new_comparator(operator_handle, &cfg.comparator_cfg,
+                               &comparator_handle),
+          "motor control: comparator init failed");
+    check(mcpwm_comparator_set_compare_value(comparator_handle,
+                                             cfg.timer_cfg.period_ticks / 2),
+          "motor control: compare value init failed");
+    generator_a = new_bridge_generator(cfg.bridge_a_gpio, false);
+    generator_b = new_bridge_generator(cfg.bridge_b_gpio, true);
+    check(mcpwm_timer_enable(timer_handle),
+          "motor control: timer enable init failed");
+    check(mcpwm_timer_start_stop(timer_handle, MCPWM_TIMER_START_NO_STOP),
+          "motor control: timer start init failed");
+    enable_driver();
   }
 
   ~MotorControl() {
+    gpio_set_level(cfg.enable_gpio, 0);
+    gpio_set_level(cfg.standby_gpio, 0);
+    mcpwm_timer_start_stop(timer_handle, MCPWM_TIMER_STOP_EMPTY);
+    mcpwm_timer_disable(timer_handle);
+    mcpwm_del_generator(generator_b);
+    mcpwm_del_generator(generator_a);
     mcpwm_del_comparator(comparator_handle);
     mcpwm_del_operator(operator_handle);
     mcpwm_del_timer(timer_handle);
@@ -86,53 +302,533 @@ public:
   /// @param duty factor of how much power to be sent to motor. negative values
   /// indicate opposite direction
   void set_duty(int32_t duty) {
+    applied_duty = duty;
     uint32_t const period_ticks = cfg.timer_cfg.period_ticks;
-    uint64_t const period_offset = period_ticks / 2;
+    int64_t const period_offset = period_ticks / 2;
     int32_t const period_duty =
-        period_offset * duty / std::numeric_limits<int32_t>::max();
+        period_offset * compensate_duty(duty) / duty_max;
     uint32_t const new_compare = cfg.timer_cfg.period_ticks / 2 + period_duty;
     mcpwm_comparator_set_compare_value(comparator_handle, new_compare);
   }
 
-private:
+  /// @brief changes pwm period. takes effect when the timer is empty, together
+  /// with the compare value rescaled to the new period, so the compare never
+  /// lies beyond the period. needs update_period_on_empty and
+  /// update_cmp_on_tez in the config
+  /// @param period_ticks new period in timer ticks
+  void set_period_ticks(uint32_t period_ticks) {
+    if (mcpwm_timer_set_period(timer_handle, period_ticks) == ESP_OK) {
+      cfg.timer_cfg.period_ticks = period_ticks;
+      set_duty(applied_duty);
+    }
+  }
+
+  /// @brief scales following duties so the effective motor voltage stays at
+  /// the nominal supply over the discharge: a full battery is scaled down, a
+  /// drained one up to max_supply_scale
+  /// @param supply_v currently measured supply voltage
+  /// implausible voltages, e.g. adc glitches, are ignored
+  void set_supply_voltage(float supply_v) {
+    if (cfg.nominal_supply_v <= 0 ||
+        supply_v < cfg.nominal_supply_v * min_plausible_supply ||
+        supply_v > cfg.nominal_supply_v * max_plausible_supply) {
+      return;
+    }
+    float const scale = std::clamp(cfg.nominal_supply_v / supply_v,
+                                   1 / max_plausible_supply, max_supply_scale);
+    supply_scale_q16 = static_cast<int32_t>(scale * (1 << 16));
+  }
+
+protected:
+  constexpr static int64_t duty_max = std::numeric_limits<int32_t>::max();
+  /// largest boost of the duty for a drained battery
+  constexpr static float max_supply_scale = 1.5f;
+  /// supply voltages outside these fractions of nominal are measurement errors
+  constexpr static float min_plausible_supply = 0.5f;
+  constexpr static float max_plausible_supply = 1.5f;
+
+  /// @param message literal, the error path allocates nothing but the exception
+  static void check(esp_err_t err, char const *message) {
+    if (err != ESP_OK) {
+      throw std::runtime_error(message);
+    }
+  }
+
+  /// @brief output high from timer empty to compare match
+  mcpwm_gen_handle_t new_bridge_generator(gpio_num_t gpio, bool inverted) {
+    mcpwm_generator_config_t const generator_cfg = {
+        .gen_gpio_num = gpio,
+        .flags = {.invert_pwm = inverted},
+    };
+    mcpwm_gen_handle_t generator;
+    check(mcpwm_new_generator(operator_handle, &generator_cfg, &generator),
+          "motor control: generator init failed");
+    check(mcpwm_generator_set_action_on_timer_event(
+              generator, MCPWM_GEN_TIMER_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP,
+                                                      MCPWM_TIMER_EVENT_EMPTY,
+                                                      MCPWM_GEN_ACTION_HIGH)),
+          "motor control: generator timer action init failed");
+    check(mcpwm_generator_set_action_on_compare_event(
+              generator, MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP,
+                                                        comparator_handle,
+                                                        MCPWM_GEN_ACTION_LOW)),
+          "motor control: generator compare action init failed");
+    return generator;
+  }
+
+  /// @brief wakes the driver once the bridges get zero duty
+  void enable_driver() {
+    gpio_config_t const standby_cfg = {
+        .pin_bit_mask = 1ULL << cfg.standby_gpio,
+        .mode = GPIO_MODE_OUTPUT,
+    };
+    check(gpio_config(&standby_cfg),
+          "motor control: standby gpio init failed");
+    gpio_set_level(cfg.standby_gpio, 1);
+
+    gpio_config_t const enable_cfg = {
+        .pin_bit_mask = 1ULL << cfg.enable_gpio,
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+    };
+    check(gpio_config(&enable_cfg),
+          "motor control: enable gpio init failed");
+    gpio_set_level(cfg.enable_gpio, 1);
+  }
+
+  /// @return duty scaled by the supply compensation and clamped to duty range
+  int64_t compensate_duty(int32_t duty) const {
+    return std::clamp((static_cast<int64_t>(duty) * supply_scale_q16) >> 16,
+                      -duty_max, duty_max);
+  }
+
   Config cfg;
   mcpwm_timer_handle_t timer_handle;
   mcpwm_oper_handle_t operator_handle;
   mcpwm_cmpr_handle_t comparator_handle;
+  mcpwm_gen_handle_t generator_a;
+  mcpwm_gen_handle_t generator_b;
+  /// nominal / actual supply voltage in q16.16, unity until first sample
+  int32_t supply_scale_q16 = 1 << 16;
+  /// latest duty, rescaled when the period changes
+  int32_t applied_duty = 0;
 };
 
-class SpeedControl {
-  constexpr static MotorControl::Config control_cfg = {0};
-  constexpr static MeasureSpeed::Config measure_cfg = {0};
+/// @brief drive train constants known at compile time
+/// @tparam wheel_circumpherance_m circumpherance of propulsion wheel in meter
+/// @tparam pulses_per_revolution tacho pulses per wheel revolution
+/// @tparam timer_resolution_hz resolution of the speed measurement timer
+/// @tparam pwm_period_ticks period of the motor pwm in mcpwm timer ticks
+template <float wheel_circumpherance_m, uint32_t pulses_per_revolution,
+          uint32_t timer_resolution_hz, uint32_t pwm_period_ticks>
+struct DriveConstants {
+  static_assert(wheel_circumpherance_m > 0,
+                "wheel circumpherance must be positive");
+  static_assert(pulses_per_revolution > 0,
+                "at least one tacho pulse per revolution required");
+  static_assert(timer_resolution_hz > 0, "timer resolution must be positive");
+  static_assert(pwm_period_ticks >= 2 && pwm_period_ticks <= UINT16_MAX,
+                "pwm period must fit the 16 bit mcpwm timer");
+
+  constexpr static uint32_t resolution_hz = timer_resolution_hz;
+  constexpr static uint32_t period_ticks = pwm_period_ticks;
+  /// distance per pulse in meter times timer resolution. speed is this
+  /// divided by the ticks between two pulses
+  constexpr static float speed_ticks_m_per_s = wheel_circumpherance_m /
+                                               pulses_per_revolution *
+                                               timer_resolution_hz;
+  /// distance travelled per tacho pulse in meter
+  constexpr static float distance_per_pulse_m =
+      wheel_circumpherance_m / pulses_per_revolution;
+  /// compare value for zero duty
+  constexpr static uint32_t period_offset = pwm_period_ticks / 2;
+};
+
+/// speed measurement with timer resolution and geometry fixed at compile time
+template <typename Constants> class StaticMeasureSpeed : public MeasureSpeed {
+public:
+  /// @param _cfg configuration. geometry and resolution are taken from
+  /// Constants
+  StaticMeasureSpeed(Config const &_cfg) : MeasureSpeed(with_constants(_cfg)) {}
+
+  /// execute this function on a tacho event. isr context
+  void on_tacho_event() {
+    isr_tacho.speed_m_per_s =
+        Constants::speed_ticks_m_per_s / take_tacho_delta();
+    isr_tacho.distance_m += Constants::distance_per_pulse_m;
+    publish_tacho();
+  }
+
+  /// @return distance travelled between two tacho events in meter
+  float get_distance_per_pulse_m() const {
+    return Constants::distance_per_pulse_m;
+  }
+
+  /// @return highest speed that is possible without a tacho event so far
+  float get_speed_bound_m_per_s() const {
+    return Constants::speed_ticks_m_per_s / ticks_since_tacho_event();
+  }
+
+  /// geometry is fixed by Constants
+  void set_wheel_circumpherance_m(float) = delete;
+
+private:
+  static Config with_constants(Config cfg) {
+    cfg.timer_cfg.resolution_hz = Constants::resolution_hz;
+    return cfg;
+  }
+};
+
+/// motor control with pwm period fixed at compile time
+template <typename Constants> class StaticMotorControl : public MotorControl {
+public:
+  /// @param _cfg configuration. pwm period is taken from Constants
+  StaticMotorControl(Config const &_cfg) : MotorControl(with_constants(_cfg)) {}
+
+  /// @brief acts like the gas pedal of a car but in both directions
+  /// @param duty factor of how much power to be sent to motor. negative values
+  /// indicate opposite direction
+  void set_duty(int32_t duty) {
+    // duty_max is 2^31 - 1, a shift is close enough and avoids the division
+    int32_t const period_duty =
+        (Constants::period_offset * compensate_duty(duty)) >> 31;
+    mcpwm_comparator_set_compare_value(comparator_handle,
+                                       Constants::period_offset + period_duty);
+  }
+
+  /// period is fixed by Constants
+  void set_period_ticks(uint32_t) = delete;
+
+private:
+  static Config with_constants(Config cfg) {
+    cfg.timer_cfg.period_ticks = Constants::period_ticks;
+    return cfg;
+  }
+};
+
+/// complete set of tunable drive parameters
+struct Parameters {
+  /// speed controller configuration
+  sig::PIDController<float>::Config pid;
+  /// motor pwm period in mcpwm timer ticks
+  uint32_t pwm_period_ticks;
+  /// circumpherance of propulsion wheel in meter
+  float wheel_circumpherance_m;
+
+  /// @return true if the set can be applied to a running control loop. the
+  /// pid output is the duty, its limits have to lie within full duty so the
+  /// anti windup acts on the real actuator limit
+  bool valid() const {
+    return std::isfinite(pid.amp_i) && std::isfinite(pid.amp_p) &&
+           std::isfinite(pid.amp_d) && std::isfinite(pid.limit_max) &&
+           std::isfinite(pid.limit_min) && pid.limit_min < pid.limit_max &&
+           pid.limit_min >= -1 && pid.limit_max <= 1 &&
+           pwm_period_ticks >= 2 && pwm_period_ticks <= UINT16_MAX &&
+           std::isfinite(wheel_circumpherance_m) && wheel_circumpherance_m > 0;
+  }
+};
+
+/// @brief closed loop speed control
+/// @tparam Measure speed measurement, MeasureSpeed or StaticMeasureSpeed
+/// @tparam Motor motor driver, MotorControl or StaticMotorControl
+template <typename Measure, typename Motor> class BasicSpeedControl {
+  constexpr static MotorControl::Config control_cfg = {
+      // 10 MHz / 500 ticks: 20 kHz, above audible range
+      .timer_cfg =
+          {
+              .group_id = 0,
+              .clk_src = MCPWM_TIMER_CLK_SRC_DEFAULT,
+              .resolution_hz = 10'000'000,
+              .count_mode = MCPWM_TIMER_COUNT_MODE_UP,
+              .period_ticks = 500,
+              // period changes from ble take effect with the next compare
+              .flags = {.update_period_on_empty = true},
+          },
+      .operator_cfg = {.group_id = 0},
+      // take new duties at the start of a period to avoid glitches
+      .comparator_cfg = {.flags = {.update_cmp_on_tez = true}},
+      // stspin233 inputs U and V, see hardware/lok
+      .bridge_a_gpio = GPIO_NUM_2,
+      .bridge_b_gpio = GPIO_NUM_21,
+      .enable_gpio = GPIO_NUM_23,
+      .standby_gpio = GPIO_NUM_16,
+      // single li-ion cell
+      .nominal_supply_v = 3.7f,
+  };
+  constexpr static MeasureSpeed::Config measure_cfg = {
+      // default until parameters from nvs or ble set it
+      .wheel_circumpherance_m = 0.06f,
+      .timer_cfg =
+          {
+              .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+              .direction = GPTIMER_COUNT_UP,
+              .resolution_hz = 1'000'000,
+          },
+      .tacho_gpio = static_cast<gpio_num_t>(CONFIG_TRAIN_TACHO_GPIO),
+  };
+  constexpr static BatteryMonitor::Config battery_cfg = {
+      .unit = ADC_UNIT_1,
+      .channel = ADC_CHANNEL_0,
+      // R1 220k, R2 47k: 4.4 V battery -> 0.78 V at the pin
+      .divider_ratio = (220.f + 47.f) / 47.f,
+      .filter_weight = 0.1f,
+  };
+  /// output is the duty, -1..1. the integrator zero cancels the motor pole
+  /// (amp_p / amp_i = 0.3 s / 10 ms), closing the loop at about 0.15 s
   constexpr static sig::PIDController<float>::Config pid_cfg = {
-      .amp_i = 1,
+      .amp_i = 0.067f,
       .amp_p = 2,
       .amp_d = 0,
-      .limit_max = 5,
-      .limit_min = -5,
+      .limit_max = 1,
+      .limit_min = -1,
   };
+  /// deceleration planned for stopping at a target distance
+  constexpr static float stop_decel_m_per_s2 = 0.2f;
+  /// estimates below are taken as standing
+  constexpr static float standstill_m_per_s = 0.005f;
 
 public:
-  SpeedControl() : measure(measure_cfg), control(control_cfg), pid(pid_cfg) {}
-  ~SpeedControl() {}
+  /// period on_control_tick has to be called with
+  constexpr static uint32_t control_period_ms = 10;
 
+private:
+  constexpr static sig::SpeedObserver::Config observer_cfg = {
+      .time_constant_s = 0.3f,
+      .tick_period_s = control_period_ms * 1e-3f,
+      .speed_at_full_duty_m_per_s = 1,
+      .process_noise = 0.001f,
+      .measurement_noise = 0.01f,
+  };
+
+public:
+  BasicSpeedControl()
+      : measure(measure_cfg), control(control_cfg), battery(battery_cfg),
+        pid(pid_cfg), observer(observer_cfg) {
+    measure.attach_tacho(on_tacho_edge, this);
+  }
+  ~BasicSpeedControl() {}
+
+  /// @brief may be called from another task, the reference is taken over at
+  /// the next control tick
   void set_ref_speed_m_per_s(float speed_m_per_s) {
-    speed_ref_m_per_s = speed_m_per_s;
+    pending_ref_speed_m_per_s.shadow() = speed_m_per_s;
+    pending_ref_speed_m_per_s.publish();
   }
 
-  void on_tacho_event() {
-    measure.on_tacho_event();
-    float const current_speed = measure.get_speed_m_per_s();
-    float const error = speed_ref_m_per_s - current_speed;
-    int32_t const duty = pid.update(error);
-    control.set_duty(duty);
+  /// @brief drive at cruise speed and stop after distance_m. may be called
+  /// from another task, the target is taken over at the next control tick.
+  /// the cruise speed is the magnitude of the latest reference speed. it is
+  /// kept after arriving, so further targets need no new reference. with a
+  /// zero reference the train never moves
+  /// @param distance_m distance to travel from the current position
+  void set_target_distance_m(float distance_m) {
+    pending_target_distance_m.shadow() = distance_m;
+    pending_target_distance_m.publish();
+  }
+
+  /// @return estimated speed, negative when driving backward
+  float get_speed_m_per_s() const { return observer.speed_m_per_s(); }
+
+  /// @return distance travelled since start in meter. may be called from any
+  /// task, updated every control tick
+  float get_distance_m() const {
+    return published_distance_m.load(std::memory_order_relaxed);
+  }
+
+  /// @brief hands a new parameter set to the control loop. may be called from
+  /// another task, the set is swapped in at the next control tick
+  /// @return false if the parameter set was rejected
+  bool request_parameters(Parameters const &params) {
+    if (!params.valid()) {
+      return false;
+    }
+    pending_parameters.shadow() = params;
+    pending_parameters.publish();
+    return true;
+  }
+
+  /// execute this function on a tacho event. isr context
+  void on_tacho_event() { measure.on_tacho_event(); }
+
+  /// @brief runs the control loop on the observed speed. call this every
+  /// control_period_ms
+  void on_control_tick() {
+    measure.update();
+    published_distance_m.store(measure.get_distance_m(),
+                               std::memory_order_relaxed);
+    apply_pending_parameters();
+    apply_pending_commands();
+
+    observer.predict(applied_duty_q16);
+    uint32_t const pulse_count = measure.get_pulse_count();
+    if (pulse_count != observed_pulse_count) {
+      observed_pulse_count = pulse_count;
+      observer.correct(
+          std::copysign(measure.get_speed_m_per_s(), travel_direction()));
+      predicted_distance_m = 0;
+    } else {
+      bound_by_pulse_distance();
+    }
+
+    if (position_mode && target_position_m <= measure.get_distance_m()) {
+      stop_at_target();
+    }
+    if (at_target) {
+      // the motor stays cut until the next command
+      trace::command_latency.on_applied();
+      return;
+    }
+
+    float const error =
+        position_ref_speed_m_per_s() - observer.speed_m_per_s();
+    // valid parameters keep the pid limits within full duty
+    float const duty = pid.update(error);
+    applied_duty_q16 = static_cast<int32_t>(std::lround(duty * (1 << 16)));
+    // the motor takes a fraction of 2^31, the observer q16.16
+    control.set_duty(static_cast<int32_t>(
+        std::clamp<int64_t>(int64_t{applied_duty_q16} << 15,
+                            -std::numeric_limits<int32_t>::max(),
+                            std::numeric_limits<int32_t>::max())));
+    trace::command_latency.on_applied();
+  }
+
+  /// sample battery and rescale motor duty accordingly. call this periodically
+  void on_battery_sample() {
+    battery.sample();
+    control.set_supply_voltage(battery.get_voltage_v());
   }
 
 private:
-  MeasureSpeed measure;
-  MotorControl control;
+  static void on_tacho_edge(void *arg) {
+    static_cast<BasicSpeedControl *>(arg)->on_tacho_event();
+  }
+
+  /// @return sign for the unsigned tacho speed. the estimate follows the
+  /// applied duty from standstill and keeps the direction while the duty
+  /// brakes against it. the duty decides only while the estimate is zero
+  float travel_direction() const {
+    float const estimate = observer.speed_m_per_s();
+    if (estimate != 0) {
+      return estimate < 0 ? -1.f : 1.f;
+    }
+    return applied_duty_q16 < 0 ? -1.f : 1.f;
+  }
+
+  /// @brief caps the estimate once the distance it predicts since the last
+  /// tacho event passes one pulse distance, the train would have produced a
+  /// pulse by then. the speed bound alone holds the estimate near zero after
+  /// standing, when the last pulse is long ago
+  void bound_by_pulse_distance() {
+    float const estimate = std::abs(observer.speed_m_per_s());
+    if (estimate < standstill_m_per_s) {
+      // standing, the next pulse is at most one pulse distance ahead
+      predicted_distance_m = 0;
+      return;
+    }
+    predicted_distance_m += estimate * control_period_ms * 1e-3f;
+    float const distance_per_pulse_m = measure.get_distance_per_pulse_m();
+    if (predicted_distance_m > distance_per_pulse_m) {
+      predicted_distance_m = distance_per_pulse_m;
+      observer.limit(measure.get_speed_bound_m_per_s());
+    }
+  }
+
+  /// swaps in parameters published by request_parameters. geometry and period
+  /// are skipped for drives that fix them at compile time
+  void apply_pending_parameters() {
+    Parameters const *params = pending_parameters.consume();
+    if (params == nullptr) {
+      return;
+    }
+    pid.configure(params->pid);
+    if constexpr (requires {
+                    measure.set_wheel_circumpherance_m(
+                        params->wheel_circumpherance_m);
+                  }) {
+      measure.set_wheel_circumpherance_m(params->wheel_circumpherance_m);
+    }
+    if constexpr (requires {
+                    control.set_period_ticks(params->pwm_period_ticks);
+                  }) {
+      control.set_period_ticks(params->pwm_period_ticks);
+    }
+  }
+
+  /// takes over reference speed and target distance published by other tasks
+  void apply_pending_commands() {
+    bool handoff = false;
+    if (float const *speed = pending_ref_speed_m_per_s.consume()) {
+      speed_ref_m_per_s = *speed;
+      cruise_speed_m_per_s = *speed;
+      handoff = true;
+    }
+    if (float const *distance = pending_target_distance_m.consume()) {
+      target_position_m = measure.get_distance_m() + *distance;
+      position_mode = true;
+      handoff = true;
+    }
+    if (handoff) {
+      at_target = false;
+      trace::command_latency.on_handoff();
+    }
+  }
+
+  /// ends position mode and cuts the motor until the next command, so neither
+  /// the integrator nor braking on the estimate move the train off the
+  /// target. the cruise speed stays for the next target
+  void stop_at_target() {
+    position_mode = false;
+    at_target = true;
+    speed_ref_m_per_s = 0;
+    pid.reset(0);
+    control.set_duty(0);
+    applied_duty_q16 = 0;
+  }
+
+  /// @return reference speed limited by the braking curve towards the target
+  /// position
+  float position_ref_speed_m_per_s() const {
+    if (!position_mode) {
+      return speed_ref_m_per_s;
+    }
+    float const remaining_m = target_position_m - measure.get_distance_m();
+    float const braking_speed = std::sqrt(2 * stop_decel_m_per_s2 * remaining_m);
+    return std::copysign(
+        std::min(std::abs(cruise_speed_m_per_s), braking_speed),
+        cruise_speed_m_per_s);
+  }
+
+  Measure measure;
+  Motor control;
+  BatteryMonitor battery;
   sig::PIDController<float> pid;
-  float speed_ref_m_per_s;
+  sig::SpeedObserver observer;
+  int32_t applied_duty_q16 = 0;
+  /// odometry for other tasks
+  std::atomic<float> published_distance_m = 0;
+  /// tacho events already fused into the observer
+  uint32_t observed_pulse_count = 0;
+  /// distance the estimate travelled since the last tacho event
+  float predicted_distance_m = 0;
+  float speed_ref_m_per_s = 0;
+  /// latest reference speed written, position mode drives at its magnitude
+  float cruise_speed_m_per_s = 0;
+  util::SwapBuffer<Parameters> pending_parameters;
+  util::SwapBuffer<float> pending_ref_speed_m_per_s;
+  util::SwapBuffer<float> pending_target_distance_m;
+  /// odometry position to stop at in position mode
+  float target_position_m = 0;
+  bool position_mode = false;
+  /// target reached, motor cut until the next command
+  bool at_target = false;
 };
 
+/// speed control configured at runtime
+using SpeedControl = BasicSpeedControl<MeasureSpeed, MotorControl>;
+
+/// speed control with drive train constants fixed at compile time
+template <typename Constants>
+using StaticSpeedControl = BasicSpeedControl<StaticMeasureSpeed<Constants>,
+                                             StaticMotorControl<Constants>>;
+
 } // namespace drive
@@ -0,0 +1,59 @@
+/** @file swap_buffer.hpp
+ * @brief lock free hand over of values between two tasks
+ * @author tomatenkuchen
+ * @date 2026-10-18
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace util {
+
+/// @brief hands complete values from one writer to one reader without locks.
+/// the writer fills a shadow slot and publishes it, the reader swaps the
+/// latest published slot in whenever it is ready. a third slot keeps the
+/// writer from ever touching the slot the reader is working on.
+template <typename T> class SwapBuffer {
+public:
+  /// @brief writer side: slot to fill before publishing
+  T &shadow();
+
+  /// @brief writer side: make the shadow slot available to the reader
+  void publish();
+
+  /// @brief reader side: take over the latest published value
+  /// @return pointer to the new value or nullptr if nothing was published
+  T const *consume();
+
+private:
+  constexpr static uint8_t index_mask = 0x03;
+  constexpr static uint8_t dirty_flag = 0x04;
+
+  std::array<T, 3> slots{};
+  /// slot owned by writer
+  uint8_t back = 0;
+  /// slot in transit, with dirty flag when published but not consumed
+  std::atomic<uint8_t> middle = 1;
+  /// slot owned by reader
+  uint8_t front = 2;
+};
+
+template <typename T> T &SwapBuffer<T>::shadow() { return slots[back]; }
+
+template <typename T> void SwapBuffer<T>::publish() {
+  back = middle.exchange(back | dirty_flag, std::memory_order_acq_rel) &
+         index_mask;
+}
+
+template <typename T> T const *SwapBuffer<T>::consume() {
+  if ((middle.load(std::memory_order_relaxed) & dirty_flag) == 0) {
+    return nullptr;
+  }
+  front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+  return &slots[front];
+}
+
+}; // namespace util
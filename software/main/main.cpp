@@ -1,29 +1,57 @@
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <optional>
 #include <stdexcept>
-#include <string>
+#include <string_view>
 
 #include "ble.hpp"
 #include "esp_log.h"
 #include "esp_log_level.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "host/ble_hs.h"
 #include "host/ble_store.h"
+#include "latency.hpp"
 #include "led.hpp"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "ota.hpp"
 #include "sdkconfig.h"
 #include "speed_ctrl.hpp"
 
 namespace {
 
-constexpr std::string TAG = "main";
+constexpr char const *TAG = "main";
 
 extern "C" void ble_store_config_init();
 
-ble::Ble *ble_ptr;
+// published by the task that owns the object with release, read by the others with acquire
+std::atomic<ble::Ble *> ble_ptr = nullptr;
+/// only used on the ble task that owns it
 led::Led *led_ptr;
+std::atomic<led::Lighting *> lighting_ptr = nullptr;
+std::atomic<drive::SpeedControl *> speed_control_ptr = nullptr;
 
 int led1_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
                     void *arg);
 int led2_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
                     void *arg);
+int config_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                      void *arg);
+int position_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                        void *arg);
+int speed_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                     void *arg);
+int latency_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                       void *arg);
+int ota_control_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                           void *arg);
+int ota_data_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                        void *arg);
 
 /* Automation IO service */
 const ble_uuid16_t auto_io_svc_uuid = BLE_UUID16_INIT(0x1815);
@@ -64,11 +92,178 @@ ble_gatt_svc_def const led_service = {
     .characteristics = led_characteristics.data(),
 };
 
-std::array<ble_gatt_svc_def, 2> ble_services = {
+/* drive service */
+const ble_uuid128_t drive_svc_uuid = BLE_UUID128_INIT(
+    0x00, 0xd2, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+uint16_t config_chr_val_handle;
+
+/// complete drive::Parameters set, little endian as laid out in memory
+static_assert(sizeof(drive::Parameters) == 28, "config characteristic layout changed");
+const ble_uuid128_t config_chr_uuid = BLE_UUID128_INIT(
+    0x01, 0xd2, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+ble_gatt_chr_def const config_characteristic = {
+    .uuid = &config_chr_uuid.u,
+    .access_cb = config_chr_access,
+    .flags = BLE_GATT_CHR_F_WRITE,
+    .val_handle = &config_chr_val_handle,
+};
+
+uint16_t position_chr_val_handle;
+
+/// write: float distance in meter to travel and stop after. read: float odometry in meter.
+/// the train cruises at the magnitude of the speed last written to the speed characteristic,
+/// with a zero speed position mode never moves. arriving stops the motor but keeps the cruise
+/// speed, so the next distance can be written alone
+const ble_uuid128_t position_chr_uuid = BLE_UUID128_INIT(
+    0x02, 0xd2, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+ble_gatt_chr_def const position_characteristic = {
+    .uuid = &position_chr_uuid.u,
+    .access_cb = position_chr_access,
+    .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+    .val_handle = &position_chr_val_handle,
+};
+
+uint16_t speed_chr_val_handle;
+
+/// write: float reference speed in meter per second
+const ble_uuid128_t speed_chr_uuid = BLE_UUID128_INIT(
+    0x03, 0xd2, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+ble_gatt_chr_def const speed_characteristic = {
+    .uuid = &speed_chr_uuid.u,
+    .access_cb = speed_chr_access,
+    .flags = BLE_GATT_CHR_F_WRITE,
+    .val_handle = &speed_chr_val_handle,
+};
+
+uint16_t latency_chr_val_handle;
+
+/// read: trace::Histogram::Summary for every trace::CommandLatency::Segment
+const ble_uuid128_t latency_chr_uuid = BLE_UUID128_INIT(
+    0x04, 0xd2, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+ble_gatt_chr_def const latency_characteristic = {
+    .uuid = &latency_chr_uuid.u,
+    .access_cb = latency_chr_access,
+    .flags = BLE_GATT_CHR_F_READ,
+    .val_handle = &latency_chr_val_handle,
+};
+
+std::array<ble_gatt_chr_def, 5> drive_characteristics = {
+    config_characteristic,
+    position_characteristic,
+    speed_characteristic,
+    latency_characteristic,
+    {0},
+};
+
+ble_gatt_svc_def const drive_service = {
+    .type = BLE_GATT_SVC_TYPE_PRIMARY,
+    .uuid = &drive_svc_uuid.u,
+    .characteristics = drive_characteristics.data(),
+};
+
+/* firmware update service */
+const ble_uuid128_t ota_svc_uuid = BLE_UUID128_INIT(
+    0x00, 0xd3, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+uint16_t ota_control_chr_val_handle;
+
+/// begin and end of a transfer, acknowledgements are notified
+const ble_uuid128_t ota_control_chr_uuid = BLE_UUID128_INIT(
+    0x01, 0xd3, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+ble_gatt_chr_def const ota_control_characteristic = {
+    .uuid = &ota_control_chr_uuid.u,
+    .access_cb = ota_control_chr_access,
+    .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_ENC | BLE_GATT_CHR_F_NOTIFY,
+    .val_handle = &ota_control_chr_val_handle,
+};
+
+uint16_t ota_data_chr_val_handle;
+
+/// sequence numbered image chunks
+const ble_uuid128_t ota_data_chr_uuid = BLE_UUID128_INIT(
+    0x02, 0xd3, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, 0xde, 0xef, 0x12, 0x12, 0x25, 0x15, 0x00, 0x00);
+
+ble_gatt_chr_def const ota_data_characteristic = {
+    .uuid = &ota_data_chr_uuid.u,
+    .access_cb = ota_data_chr_access,
+    .flags = BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_WRITE_ENC,
+    .val_handle = &ota_data_chr_val_handle,
+};
+
+std::array<ble_gatt_chr_def, 3> ota_characteristics = {
+    ota_control_characteristic,
+    ota_data_characteristic,
+    {0},
+};
+
+ble_gatt_svc_def const ota_service = {
+    .type = BLE_GATT_SVC_TYPE_PRIMARY,
+    .uuid = &ota_svc_uuid.u,
+    .characteristics = ota_characteristics.data(),
+};
+
+std::array<ble_gatt_svc_def, 4> ble_services = {
     led_service,
+    drive_service,
+    ota_service,
     {0},
 };
 
+ota::Updater ota_updater(&ota_control_chr_val_handle);
+
+constexpr std::string_view device_name = "henri-lok";
+static_assert(device_name.size() <= ble::Ble::max_device_name_length,
+              "device name does not fit into the advertizing data");
+
+constexpr char const *parameter_nvs_namespace = "drive";
+constexpr char const *parameter_nvs_key = "params";
+
+/// nvs holds the drive parameters and the ble bonds, both tasks need it
+void init_nvs() {
+  esp_err_t ret = nvs_flash_init();
+  if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ret = nvs_flash_init();
+  }
+  if (ret != ESP_OK) {
+    throw std::runtime_error("nvs init failed");
+  }
+}
+
+/// store parameter set so it survives a reboot
+void save_parameters(drive::Parameters const &params) {
+  nvs_handle_t handle;
+  if (nvs_open(parameter_nvs_namespace, NVS_READWRITE, &handle) != ESP_OK) {
+    ESP_LOGE("main", "parameters could not be saved");
+    return;
+  }
+  if (nvs_set_blob(handle, parameter_nvs_key, &params, sizeof(params)) != ESP_OK ||
+      nvs_commit(handle) != ESP_OK) {
+    ESP_LOGE("main", "parameters could not be saved");
+  }
+  nvs_close(handle);
+}
+
+/// restore parameter set stored by save_parameters
+/// @return true if a stored set was found
+bool load_parameters(drive::Parameters &params) {
+  nvs_handle_t handle;
+  if (nvs_open(parameter_nvs_namespace, NVS_READONLY, &handle) != ESP_OK) {
+    return false;
+  }
+  size_t size = sizeof(params);
+  bool const found = nvs_get_blob(handle, parameter_nvs_key, &params, &size) == ESP_OK &&
+                     size == sizeof(params);
+  nvs_close(handle);
+  return found;
+}
+
 int led1_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
                     void *arg) {
   if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
@@ -77,12 +272,12 @@ int led1_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_
 
   // Verify attribute handle
   if (attr_handle != led1_chr_val_handle) {
-    throw std::runtime_error("unexpected access operation on led characteristic");
+    return BLE_ATT_ERR_UNLIKELY;
   }
 
   // Verify access buffer length
   if (ctxt->om->om_len != 1) {
-    throw std::runtime_error("unexpected access operation on led characteristic");
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
   }
 
   // Turn the LED on or off according to the operation bit
@@ -105,12 +300,12 @@ int led2_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_
 
   // Verify attribute handle
   if (attr_handle != led2_chr_val_handle) {
-    throw std::runtime_error("unexpected access operation on led characteristic");
+    return BLE_ATT_ERR_UNLIKELY;
   }
 
   // Verify access buffer length
   if (ctxt->om->om_len != 1) {
-    throw std::runtime_error("unexpected access operation on led characteristic");
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
   }
 
   // Turn the LED on or off according to the operation bit
@@ -131,31 +326,250 @@ int led2_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_
   return 0;
 }
 
-void speed_control_task(void *param) {
+int config_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                      void *arg) {
+  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    return BLE_ERR_UNSPECIFIED;
+  }
+
+  if (attr_handle != config_chr_val_handle) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  drive::Parameters params;
+  uint16_t len = 0;
+  if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(params) ||
+      ble_hs_mbuf_to_flat(ctxt->om, &params, sizeof(params), &len) != 0) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+
+  auto *const speed_control = speed_control_ptr.load(std::memory_order_acquire);
+  if (speed_control == nullptr) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  if (!speed_control->request_parameters(params)) {
+    ESP_LOGI("main", "parameter set rejected");
+    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+  }
+
+  ESP_LOGI("main", "parameter set accepted");
+  save_parameters(params);
+
+  return 0;
+}
+
+int position_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                        void *arg) {
+  auto *const speed_control = speed_control_ptr.load(std::memory_order_acquire);
+  if (attr_handle != position_chr_val_handle || speed_control == nullptr) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+    float const distance_m = speed_control->get_distance_m();
+    if (os_mbuf_append(ctxt->om, &distance_m, sizeof(distance_m)) != 0) {
+      return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return 0;
+  }
+
+  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    return BLE_ERR_UNSPECIFIED;
+  }
+
+  float distance_m;
+  uint16_t len = 0;
+  if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(distance_m) ||
+      ble_hs_mbuf_to_flat(ctxt->om, &distance_m, sizeof(distance_m), &len) != 0) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+
+  if (!std::isfinite(distance_m) || distance_m < 0) {
+    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+  }
+
+  trace::command_latency.on_access();
+  ESP_LOGI("main", "stop after %f m", distance_m);
+  speed_control->set_target_distance_m(distance_m);
+
+  return 0;
+}
+
+int speed_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                     void *arg) {
+  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    return BLE_ERR_UNSPECIFIED;
+  }
+
+  auto *const speed_control = speed_control_ptr.load(std::memory_order_acquire);
+  if (attr_handle != speed_chr_val_handle || speed_control == nullptr) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  float speed_m_per_s;
+  uint16_t len = 0;
+  if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(speed_m_per_s) ||
+      ble_hs_mbuf_to_flat(ctxt->om, &speed_m_per_s, sizeof(speed_m_per_s), &len) != 0) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+
+  if (!std::isfinite(speed_m_per_s)) {
+    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+  }
+
+  trace::command_latency.on_access();
+  speed_control->set_ref_speed_m_per_s(speed_m_per_s);
+
+  return 0;
+}
+
+int latency_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                       void *arg) {
+  if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
+    return BLE_ERR_UNSPECIFIED;
+  }
+
+  using Segment = trace::CommandLatency::Segment;
+  std::array<trace::Histogram::Summary, 3> const summaries = {
+      trace::command_latency.summary(Segment::access_to_handoff),
+      trace::command_latency.summary(Segment::handoff_to_applied),
+      trace::command_latency.summary(Segment::total),
+  };
+  if (os_mbuf_append(ctxt->om, summaries.data(), sizeof(summaries)) != 0) {
+    return BLE_ATT_ERR_INSUFFICIENT_RES;
+  }
+
+  return 0;
+}
+
+int ota_control_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                           void *arg) {
+  return ota_updater.on_control(conn_handle, ctxt);
+}
+
+int ota_data_chr_access(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_access_ctxt *ctxt,
+                        void *arg) {
+  return ota_updater.on_data(conn_handle, ctxt);
+}
+
+/// log gap event rate and handling time
+/// @param interval_ms time since the previous call
+void log_gap_events(uint32_t interval_ms) {
+  static uint32_t previous_count = 0;
+  auto const *const ble = ble_ptr.load(std::memory_order_acquire);
+  if (ble == nullptr) {
+    return;
+  }
+  auto const events = ble->event_statistics();
+  ESP_LOGI("main", "gap events: n=%lu rate=%lu/s p50=%luus p99=%luus max=%luus", events.count,
+           (events.count - previous_count) * 1000 / interval_ms, events.p50_us, events.p99_us,
+           events.max_us);
+  previous_count = events.count;
+}
+
+void log_latency() {
+  auto const total = trace::command_latency.summary(trace::CommandLatency::Segment::total);
+  ESP_LOGI("main", "command latency: n=%lu p50=%luus p99=%luus max=%luus", total.count,
+           total.p50_us, total.p99_us, total.max_us);
+}
+
+TaskHandle_t ble_task_handle;
+TaskHandle_t speed_control_task_handle;
+
+void speed_control_loop() {
   drive::SpeedControl speed_control;
-  while (true) {
-    vTaskDelay(100);
+
+  drive::Parameters params;
+  if (load_parameters(params)) {
+    speed_control.request_parameters(params);
   }
+  speed_control_ptr.store(&speed_control, std::memory_order_release);
+
+  constexpr TickType_t control_period_ticks =
+      pdMS_TO_TICKS(drive::SpeedControl::control_period_ms);
+  constexpr uint32_t battery_sample_period_ticks = 100;
+
+  TickType_t last_wake = xTaskGetTickCount();
+  for (uint32_t tick = 0;; ++tick) {
+    speed_control.on_control_tick();
+    if (tick % battery_sample_period_ticks == 0) {
+      speed_control.on_battery_sample();
+    }
+    if (auto *const lighting = lighting_ptr.load(std::memory_order_acquire)) {
+      lighting->set_speed_m_per_s(speed_control.get_speed_m_per_s());
+    }
+    vTaskDelayUntil(&last_wake, control_period_ticks);
+  }
+}
+
+void speed_control_task(void *param) {
+  try {
+    speed_control_loop();
+  } catch (std::runtime_error &e) {
+    ESP_LOGE("main", "speed control: %s", e.what());
+  }
+  // the heart beat must not query the deleted task
+  speed_control_task_handle = nullptr;
   vTaskDelete(NULL);
 }
 
+/// new bonds are only made this long after power up. the train has no buttons, switching it on
+/// is the only way to show physical access
+constexpr int64_t pairing_window_us = 120 * 1000 * 1000;
+
+bool pairing_window_open() { return esp_timer_get_time() < pairing_window_us; }
+
+/// a bonded peer that lost its keys pairs again. the stale bond is dropped so pairing can repeat,
+/// inside the pairing window only
+int repeat_pairing_event(ble_gap_event *event) {
+  if (!pairing_window_open()) {
+    return BLE_GAP_REPEAT_PAIRING_IGNORE;
+  }
+  ble_gap_conn_desc desc;
+  if (ble_gap_conn_find(event->repeat_pairing.conn_handle, &desc) != 0) {
+    return BLE_GAP_REPEAT_PAIRING_IGNORE;
+  }
+  ble_store_util_delete_peer(&desc.peer_id_addr);
+  return BLE_GAP_REPEAT_PAIRING_RETRY;
+}
+
 /// callback routine for gap event servicing
 /// @param event type of event that occured
 /// @param args additional info besides event data. not used by any callback but
 /// required by callback type
 int event_handler(ble_gap_event *event, void *args) {
   ESP_LOGI("main", "event callback");
-  ble_ptr->event_handler(event);
-
-  return 0;
+  switch (event->type) {
+    case BLE_GAP_EVENT_REPEAT_PAIRING:
+      return repeat_pairing_event(event);
+    case BLE_GAP_EVENT_CONNECT:
+      // pairing after the window still encrypts the link, but the peer is not bonded and so
+      // not trusted with firmware updates
+      ble_hs_cfg.sm_bonding = pairing_window_open();
+      break;
+    case BLE_GAP_EVENT_DISCONNECT:
+      ota_updater.on_disconnect(event->disconnect.conn.conn_handle);
+      break;
+    default:
+      break;
+  }
+  return ble_ptr.load(std::memory_order_acquire)->event_handler(event);
 }
 
 void on_stack_reset(int reason) { ESP_LOGI("main", "ble stack reset"); }
 
-void on_stack_sync() { ble_ptr->start_advertising(); }
+/// an updated image is kept once it brought up the ble host, otherwise the bootloader rolls back
+/// on the next reset and the train stays reachable for another update. a failed start resets
+/// the host, which syncs and calls this again
+void on_stack_sync() {
+  if (ble_ptr.load(std::memory_order_acquire)->start_advertising_or_reset()) {
+    ota::confirm_running_image();
+  }
+}
 
 void service_register_callback(ble_gatt_register_ctxt *ctxt, void *arg) {
-  ESP_LOGI(TAG.c_str(), "gatt service register callback called");
+  ESP_LOGI(TAG, "gatt service register callback called");
 }
 
 void add_callbacks() {
@@ -164,9 +578,24 @@ void add_callbacks() {
   ble_hs_cfg.gatts_register_cb = service_register_callback;
   ble_hs_cfg.store_status_cb = ble_store_util_status_rr;
 
+  // the train has no display or buttons, so pairing is just works with secure connections.
+  // bonding keeps the keys, firmware updates are only accepted from bonded peers. bonds are
+  // made within pairing_window_us after power up only
+  ble_hs_cfg.sm_io_cap = BLE_SM_IO_CAP_NO_IO;
+  ble_hs_cfg.sm_bonding = 1;
+  ble_hs_cfg.sm_sc = 1;
+  ble_hs_cfg.sm_our_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+  ble_hs_cfg.sm_their_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+
   ble_store_config_init();
 }
 
+#ifdef CONFIG_BLINK_LED_STRIP
+/// not on the ble task stack: its frame timer keeps running after nimble_host_task deleted the
+/// task without unwinding the stack
+std::optional<led::Lighting> lighting;
+#endif
+
 void ble_nimble_task(void *param) {
   constexpr gpio_num_t led_gpio = static_cast<gpio_num_t>(15);
   led::Led Led(led_gpio);
@@ -174,8 +603,21 @@ void ble_nimble_task(void *param) {
 
   ESP_LOGI("main", "led init complete");
 
-  ble::Ble ble("henri-lok", event_handler, ble_services.data(), ble::Ble::Antenna::external);
-  ble_ptr = &ble;
+#ifdef CONFIG_BLINK_LED_STRIP
+  auto &lights = lighting.emplace(led::Lighting::Config{
+      .pin = static_cast<gpio_num_t>(CONFIG_BLINK_GPIO),
+      .led_count = CONFIG_TRAIN_LED_STRIP_COUNT,
+      .front_count = CONFIG_TRAIN_LED_STRIP_COUNT / 2,
+      .back_count = CONFIG_TRAIN_LED_STRIP_COUNT / 2,
+      .frame_period_ms = 20,
+  });
+  lighting_ptr.store(&lights, std::memory_order_release);
+
+  ESP_LOGI("main", "lighting init complete");
+#endif
+
+  ble::Ble ble(device_name, event_handler, ble_services.data(), ble::Ble::Antenna::external);
+  ble_ptr.store(&ble, std::memory_order_release);
 
   ESP_LOGI("main", "ble init complete");
 
@@ -183,24 +625,104 @@ void ble_nimble_task(void *param) {
 
   ESP_LOGI("main", "callbacks added");
 
+  // runs the nimble host until the stack is shut down
   ble.nimble_host_task();
+}
 
-  while (true) {
-    ESP_LOGI("main", "ble heart beat");
-    vTaskDelay(200);
+/// above the ble task, so bursts of gatt traffic do not delay control ticks
+constexpr UBaseType_t speed_control_task_priority = 6;
+
+#ifdef CONFIG_TRAIN_STATIC_ALLOCATION
+StackType_t ble_task_stack[CONFIG_TRAIN_BLE_TASK_STACK_SIZE];
+StaticTask_t ble_task_buffer;
+StackType_t speed_control_task_stack[CONFIG_TRAIN_SPEED_CONTROL_TASK_STACK_SIZE];
+StaticTask_t speed_control_task_buffer;
+
+/// statically allocated ram per module in bytes
+struct ModuleBudget {
+  char const *module;
+  size_t bytes;
+};
+
+constexpr auto memory_budget = std::to_array<ModuleBudget>({
+    {"ble task", sizeof(ble_task_stack) + sizeof(ble_task_buffer)},
+    {"speed control task", sizeof(speed_control_task_stack) + sizeof(speed_control_task_buffer)},
+    {"ota", sizeof(ota_updater)},
+    {"latency trace", sizeof(trace::command_latency)},
+#ifdef CONFIG_BLINK_LED_STRIP
+    {"lighting", sizeof(lighting)},
+#endif
+});
+
+constexpr size_t memory_budget_total() {
+  size_t total = 0;
+  for (auto const &entry : memory_budget) {
+    total += entry.bytes;
+  }
+  return total;
+}
+
+static_assert(memory_budget_total() <= CONFIG_TRAIN_STATIC_RAM_BUDGET,
+              "statically allocated ram exceeds CONFIG_TRAIN_STATIC_RAM_BUDGET");
+
+void log_memory_budget() {
+  for (auto const &entry : memory_budget) {
+    ESP_LOGI("main", "ram budget: %s %u bytes", entry.module, entry.bytes);
+  }
+  ESP_LOGI("main", "ram budget: total %u of %u bytes", memory_budget_total(),
+           CONFIG_TRAIN_STATIC_RAM_BUDGET);
+}
+#endif
+
+void create_tasks() {
+#ifdef CONFIG_TRAIN_STATIC_ALLOCATION
+  log_memory_budget();
+  ble_task_handle = xTaskCreateStatic(ble_nimble_task, "ble task", sizeof(ble_task_stack), NULL, 5,
+                                      ble_task_stack, &ble_task_buffer);
+  speed_control_task_handle = xTaskCreateStatic(
+      speed_control_task, "speed control", sizeof(speed_control_task_stack), NULL,
+      speed_control_task_priority, speed_control_task_stack, &speed_control_task_buffer);
+#else
+  xTaskCreate(ble_nimble_task, "ble task", CONFIG_TRAIN_BLE_TASK_STACK_SIZE, NULL, 5,
+              &ble_task_handle);
+  xTaskCreate(speed_control_task, "speed control", CONFIG_TRAIN_SPEED_CONTROL_TASK_STACK_SIZE,
+              NULL, speed_control_task_priority, &speed_control_task_handle);
+#endif
+}
+
+/// log unused stack of a task in bytes
+void log_stack_headroom(char const *name, TaskHandle_t task) {
+  if (task != nullptr) {
+    ESP_LOGI("main", "stack headroom %s: %u bytes", name, uxTaskGetStackHighWaterMark(task));
   }
 }
 
+constexpr TickType_t heart_beat_ticks = 200;
+
 }  // namespace
 
 extern "C" void app_main() {
   try {
-    xTaskCreate(ble_nimble_task, "ble task", 8 * 1024, NULL, 5, NULL);
-    // xTaskCreate(speed_control_task, "Heart Rate", 4 * 1024, NULL, 5, NULL);
+    init_nvs();
+    create_tasks();
   } catch (std::runtime_error &e) {
-    std::string const err_msg = e.what();
-    ESP_LOGE("main", "error: %s", err_msg.c_str());
+    ESP_LOGE("main", "error: %s", e.what());
   } catch (...) {
     ESP_LOGE("main", "unknown error occured");
   }
+
+  while (true) {
+    ESP_LOGI("main", "heart beat");
+    log_stack_headroom("ble", ble_task_handle);
+    log_stack_headroom("speed control", speed_control_task_handle);
+    log_gap_events(pdTICKS_TO_MS(heart_beat_ticks));
+    if constexpr (trace::enabled) {
+      log_latency();
+    }
+    if (ota_updater.restart_pending()) {
+      ESP_LOGI("main", "firmware updated, restarting");
+      esp_restart();
+    }
+    vTaskDelay(heart_beat_ticks);
+  }
 }
@@ -1,13 +1,14 @@
 #include <array>
 #include <cstdint>
 #include <stdexcept>
-#include <string>
+#include <algorithm>
 #include <string_view>
 
 #include "ble.hpp"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_log_level.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "host/ble_gap.h"
@@ -21,7 +22,6 @@
 #include "nimble/hci_common.h"
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
-#include "nvs_flash.h"
 #include "sdkconfig.h"
 #include "services/gap/ble_svc_gap.h"
 
@@ -29,15 +29,13 @@ extern "C" void ble_store_config_init();
 
 namespace ble {
 
-constexpr std::string TAG = "ble";
+constexpr char const *TAG = "ble";
 
-Ble::Ble(std::string _device_name, ble_gap_event_fn *_external_event_handler,
+Ble::Ble(std::string_view _device_name, ble_gap_event_fn *_external_event_handler,
          ble_gatt_svc_def *services, Antenna antenna)
     : external_event_handler{_external_event_handler} {
   choose_antenna(antenna);
   ESP_LOGI("ble", "constructor: antenna chosen");
-  init_nvs();
-  ESP_LOGI("ble", "constructor: nvs init ok");
   init_nimble_hci();
   ESP_LOGI("ble", "constructor: nimble hci init ok");
   init_nimble_port();
@@ -59,19 +57,21 @@ void Ble::format_addr(char *addr_str, uint8_t addr[]) {
 
 int Ble::connect_event(ble_gap_event *event) {
   // A new connection was established or a connection attempt failed
-  ESP_LOGI(TAG.c_str(), "connection %s; status=%d",
+  ESP_LOGI(TAG, "connection %s; status=%d",
            event->connect.status == 0 ? "established" : "failed", event->connect.status);
 
   if (event->connect.status != 0) {
     // Connection failed
-    start_advertising();
+    start_advertising_or_reset();
     return 0;
   }
 
   // Check connection handle
   ble_gap_conn_desc desc;
-  if (ble_gap_conn_find(event->connect.conn_handle, &desc) != 0) {
-    throw std::runtime_error("failed to find connection by handle");
+  int rc = ble_gap_conn_find(event->connect.conn_handle, &desc);
+  if (rc != 0) {
+    ESP_LOGE(TAG, "failed to find connection by handle; rc=%d", rc);
+    return rc;
   }
 
   // Try to update connection parameters
@@ -82,8 +82,10 @@ int Ble::connect_event(ble_gap_event *event) {
       .supervision_timeout = desc.supervision_timeout,
   };
 
-  if (ble_gap_update_params(event->connect.conn_handle, &params) != 0) {
-    throw std::runtime_error("failed to update connection parameters");
+  rc = ble_gap_update_params(event->connect.conn_handle, &params);
+  if (rc != 0) {
+    ESP_LOGE(TAG, "failed to update connection parameters; rc=%d", rc);
+    return rc;
   }
 
   return 0;
@@ -91,20 +93,27 @@ int Ble::connect_event(ble_gap_event *event) {
 
 void Ble::disconnect_event(ble_gap_event *event) {
   ESP_LOGI("ble", "disconnected");
-  start_advertising();
+  start_advertising_or_reset();
 }
 
 void Ble::advertizing_complete_event(ble_gap_event *event) {
   ESP_LOGI("ble", "advertizing complete. restart");
-  start_advertising();
+  start_advertising_or_reset();
 }
 
-void Ble::event_handler(ble_gap_event *event) {
+void Ble::mtu_event(ble_gap_event *event) {
+  ESP_LOGI("ble", "mtu update; conn_handle=%d mtu=%d", event->mtu.conn_handle, event->mtu.value);
+}
+
+int Ble::event_handler(ble_gap_event *event) {
+  int64_t const start_us = esp_timer_get_time();
+  int rc = 0;
+
   // Handle different GAP event
   switch (event->type) {
     // Connect event
     case BLE_GAP_EVENT_CONNECT:
-      connect_event(event);
+      rc = connect_event(event);
       break;
     case BLE_GAP_EVENT_DISCONNECT:
       disconnect_event(event);
@@ -112,26 +121,40 @@ void Ble::event_handler(ble_gap_event *event) {
     case BLE_GAP_EVENT_ADV_COMPLETE:
       advertizing_complete_event(event);
       break;
+    case BLE_GAP_EVENT_MTU:
+      mtu_event(event);
+      break;
     default:
       ESP_LOGI("ble", "gap event type %d", event->type);
       break;
   }
+
+  event_latency.add(static_cast<uint32_t>(esp_timer_get_time() - start_us));
+  return rc;
 }
 
-void Ble::start_advertising() {
+bool Ble::start_advertising() {
   ESP_LOGI("ble", "start advertizing");
 
+  // one of several connections dropped while advertizing for the next
+  if (ble_gap_adv_active()) {
+    return true;
+  }
+
   if (ble_hs_util_ensure_addr(0) != 0) {
-    throw std::runtime_error("failed to ensure address");
+    ESP_LOGE(TAG, "failed to ensure address");
+    return false;
   }
 
   if (ble_hs_id_infer_auto(0, &own_addr_type) != 0) {
-    throw std::runtime_error("failed to infer auto address");
+    ESP_LOGE(TAG, "failed to infer auto address");
+    return false;
   }
 
   uint8_t address_value[18] = {0};
   if (ble_hs_id_copy_addr(own_addr_type, address_value, nullptr) != 0) {
-    throw std::runtime_error("failed address copy");
+    ESP_LOGE(TAG, "failed address copy");
+    return false;
   }
 
   // print address
@@ -140,20 +163,33 @@ void Ble::start_advertising() {
            address_value[5]);
 
   if (ble_gap_adv_set_fields(&adv_fields) != 0) {
-    throw std::runtime_error("failed to set advertising data");
+    ESP_LOGE(TAG, "failed to set advertising data");
+    return false;
   }
 
   if (ble_gap_adv_rsp_set_fields(&rsp_fields) != 0) {
-    throw std::runtime_error("failed to set scan response data");
+    ESP_LOGE(TAG, "failed to set scan response data");
+    return false;
   }
 
   // Start advertising
   if (ble_gap_adv_start(own_addr_type, NULL, BLE_HS_FOREVER, &adv_params, external_event_handler,
                         NULL) != 0) {
-    throw std::runtime_error("failed to start advertising");
+    ESP_LOGE(TAG, "failed to start advertising");
+    return false;
   }
 
-  ESP_LOGI(TAG.c_str(), "advertising started!");
+  ESP_LOGI(TAG, "advertising started!");
+  return true;
+}
+
+bool Ble::start_advertising_or_reset() {
+  if (start_advertising()) {
+    return true;
+  }
+  ESP_LOGE(TAG, "advertising failed, resetting host");
+  ble_hs_sched_reset(BLE_HS_EUNKNOWN);
+  return false;
 }
 
 void Ble::stop_advertizing() { ble_gap_adv_stop(); }
@@ -176,18 +212,22 @@ void Ble::init_gatt(ble_gatt_svc_def *services) {
   }
 }
 
-void Ble::init_gap(std::string _device_name) {
+void Ble::init_gap(std::string_view _device_name) {
+  if (_device_name.size() > max_device_name_length) {
+    throw std::runtime_error("device name too long");
+  }
+
   // fill in device name to advertizing struct
-  device_name = _device_name;
-  adv_fields.name = reinterpret_cast<uint8_t const *>(device_name.c_str());
-  adv_fields.name_len = static_cast<uint8_t>(device_name.size());
+  *std::copy(_device_name.begin(), _device_name.end(), device_name.begin()) = '\0';
+  adv_fields.name = reinterpret_cast<uint8_t const *>(device_name.data());
+  adv_fields.name_len = static_cast<uint8_t>(_device_name.size());
   adv_fields.name_is_complete = 1;
 
   ble_svc_gap_init();
 
   ESP_LOGI("ble", "init gap: gap init ok");
 
-  if (ble_svc_gap_device_name_set(_device_name.c_str()) != 0) {
+  if (ble_svc_gap_device_name_set(device_name.data()) != 0) {
     throw std::runtime_error("gap device name could not be set");
   }
 
@@ -199,17 +239,6 @@ void Ble::nimble_host_task() {
   vTaskDelete(NULL);
 }
 
-void Ble::init_nvs() {
-  esp_err_t ret = nvs_flash_init();
-  if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-    ESP_ERROR_CHECK(nvs_flash_erase());
-    ret = nvs_flash_init();
-  }
-  if (ret != ESP_OK) {
-    throw std::runtime_error("nvs init failed");
-  }
-}
-
 void Ble::init_nimble_port() {
   if (nimble_port_init() != ESP_OK) {
     throw std::runtime_error("nimble port init failed");
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
 #include "driver/gpio.h"
 #include "led.hpp"
 
@@ -12,4 +16,138 @@ void Led::on() { gpio_set_level(pin, false); }
 
 void Led::off() { gpio_set_level(pin, true); }
 
+Lighting::Lighting(Config const &_cfg) : cfg{_cfg} {
+  if (cfg.led_count > max_led_count || cfg.front_count + cfg.back_count > cfg.led_count) {
+    throw std::runtime_error("lighting: invalid led layout");
+  }
+
+  led_strip_config_t const strip_cfg = {
+      .strip_gpio_num = cfg.pin,
+      .max_leds = cfg.led_count,
+      .led_model = LED_MODEL_WS2812,
+  };
+
+#ifdef CONFIG_BLINK_LED_STRIP_BACKEND_SPI
+  led_strip_spi_config_t const spi_cfg = {
+      .spi_bus = SPI2_HOST,
+      .flags = {.with_dma = true},
+  };
+  if (led_strip_new_spi_device(&strip_cfg, &spi_cfg, &strip) != ESP_OK) {
+    throw std::runtime_error("lighting: led strip init failed");
+  }
+#else
+  // the rmt of this chip has no dma, the strip is short enough for the channel memory
+  led_strip_rmt_config_t const rmt_cfg = {
+      .clk_src = RMT_CLK_SRC_DEFAULT,
+      .resolution_hz = 10 * 1000 * 1000,
+      .flags = {.with_dma = false},
+  };
+  if (led_strip_new_rmt_device(&strip_cfg, &rmt_cfg, &strip) != ESP_OK) {
+    throw std::runtime_error("lighting: led strip init failed");
+  }
+#endif
+  led_strip_clear(strip);
+
+  strip_mutex = xSemaphoreCreateMutexStatic(&strip_mutex_buffer);
+  refresh_task_handle =
+      xTaskCreateStatic(refresh_task, "lighting", sizeof(refresh_task_stack), this,
+                        refresh_task_priority, refresh_task_stack, &refresh_task_buffer);
+
+  esp_timer_create_args_t const timer_args = {
+      .callback = on_frame_timer,
+      .arg = this,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "lighting",
+  };
+  if (esp_timer_create(&timer_args, &frame_timer) != ESP_OK ||
+      esp_timer_start_periodic(frame_timer, cfg.frame_period_ms * 1000) != ESP_OK) {
+    vTaskDelete(refresh_task_handle);
+    throw std::runtime_error("lighting: frame timer init failed");
+  }
+}
+
+Lighting::~Lighting() {
+  esp_timer_stop(frame_timer);
+  esp_timer_delete(frame_timer);
+  // the refresh task only blocks on the mutex or its notification, never inside a transfer
+  xSemaphoreTake(strip_mutex, portMAX_DELAY);
+  vTaskDelete(refresh_task_handle);
+  led_strip_clear(strip);
+  led_strip_del(strip);
+  xSemaphoreGive(strip_mutex);
+  vSemaphoreDelete(strip_mutex);
+}
+
+void Lighting::set_speed_m_per_s(float _speed_m_per_s) {
+  // brightness is derived from the speed, a nan would end up in an integer conversion
+  if (!std::isfinite(_speed_m_per_s)) {
+    return;
+  }
+  speed_m_per_s.store(_speed_m_per_s, std::memory_order_relaxed);
+}
+
+void Lighting::on_frame_timer(void *arg) {
+  auto *lighting = static_cast<Lighting *>(arg);
+  lighting->render();
+  lighting->publish();
+}
+
+void Lighting::refresh_task(void *arg) {
+  auto *lighting = static_cast<Lighting *>(arg);
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    xSemaphoreTake(lighting->strip_mutex, portMAX_DELAY);
+    if (auto const *latest = lighting->frames.consume()) {
+      lighting->send(*latest);
+    }
+    xSemaphoreGive(lighting->strip_mutex);
+  }
+}
+
+void Lighting::render() {
+  ++frame_count;
+  float const speed = speed_m_per_s.load(std::memory_order_relaxed);
+  bool const standing = std::abs(speed) < standstill_m_per_s;
+  if (!standing) {
+    forward = speed > 0;
+  }
+
+  // head lights brighten with speed, dimmed while standing
+  float const beam =
+      standing ? 0.2f : 0.4f + 0.6f * std::min(std::abs(speed) / full_beam_m_per_s, 1.f);
+  uint8_t const head = static_cast<uint8_t>(255 * beam);
+  Rgb const head_light = {head, head, head};
+
+  // tail lights pulse slowly while standing, once per 64 frames
+  uint32_t const phase = frame_count % 64;
+  uint8_t const tail = standing ? static_cast<uint8_t>(64 + 3 * (phase < 32 ? phase : 63 - phase))
+                                : 160;
+  Rgb const tail_light = {tail, 0, 0};
+
+  frame.fill({0, 0, 0});
+  fill(0, cfg.front_count, forward ? head_light : tail_light);
+  fill(cfg.led_count - cfg.back_count, cfg.back_count, forward ? tail_light : head_light);
+}
+
+void Lighting::fill(uint32_t first, uint32_t count, Rgb color) {
+  std::fill_n(frame.begin() + first, count, color);
+}
+
+void Lighting::publish() {
+  if (frame == published_frame) {
+    return;
+  }
+  frames.shadow() = frame;
+  frames.publish();
+  published_frame = frame;
+  xTaskNotifyGive(refresh_task_handle);
+}
+
+void Lighting::send(Frame const &_frame) {
+  for (uint32_t i = 0; i < cfg.led_count; ++i) {
+    led_strip_set_pixel(strip, i, _frame[i].red, _frame[i].green, _frame[i].blue);
+  }
+  led_strip_refresh(strip);
+}
+
 }  // namespace led
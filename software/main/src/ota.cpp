@@ -0,0 +1,175 @@
+#include "ota.hpp"
+
+#include <algorithm>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host/ble_gatt.h"
+#include "host/ble_hs.h"
+
+namespace ota {
+
+void confirm_running_image() {
+  esp_ota_img_states_t state;
+  if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK ||
+      state != ESP_OTA_IMG_PENDING_VERIFY) {
+    return;
+  }
+  if (esp_ota_mark_app_valid_cancel_rollback() != ESP_OK) {
+    ESP_LOGE("ota", "running image could not be confirmed");
+    return;
+  }
+  ESP_LOGI("ota", "running image confirmed, rollback cancelled");
+}
+
+bool FlashSink::begin(uint32_t image_size) {
+  partition = esp_ota_get_next_update_partition(nullptr);
+  if (partition == nullptr) {
+    ESP_LOGE("ota", "no ota partition");
+    return false;
+  }
+  // erasing image_size bytes up front takes seconds, inside a gatt callback that stalls the
+  // connection. sequential writes erase each sector when the write reaches it
+  return esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &handle) == ESP_OK;
+}
+
+bool FlashSink::write(std::span<uint8_t const> data) {
+  return esp_ota_write(handle, data.data(), data.size()) == ESP_OK;
+}
+
+bool FlashSink::end() {
+  if (esp_ota_end(handle) != ESP_OK) {
+    return false;
+  }
+  return esp_ota_set_boot_partition(partition) == ESP_OK;
+}
+
+void FlashSink::abort() { esp_ota_abort(handle); }
+
+Updater::Updater(uint16_t const *_notify_handle)
+    : notify_handle{_notify_handle}, transfer{sink} {}
+
+int Updater::on_control(uint16_t conn_handle, ble_gatt_access_ctxt *ctxt) {
+  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  uint16_t len = 0;
+  if (ble_hs_mbuf_to_flat(ctxt->om, buffer.data(), buffer.size(), &len) != 0 || len == 0) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+
+  switch (static_cast<Command>(buffer[0])) {
+    case Command::begin: {
+      if (len != 6) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+      }
+      if (!trusted(conn_handle)) {
+        ESP_LOGW("ota", "begin refused: link not encrypted or peer not bonded");
+        return BLE_ATT_ERR_INSUFFICIENT_AUTHEN;
+      }
+      uint32_t const image_size =
+          buffer[1] | buffer[2] << 8 | buffer[3] << 16 | static_cast<uint32_t>(buffer[4]) << 24;
+      image_ready.store(false, std::memory_order_release);
+      if (!transfer.begin(image_size, buffer[5])) {
+        ESP_LOGE("ota", "begin failed");
+        return BLE_ATT_ERR_UNLIKELY;
+      }
+      transfer_conn_handle = conn_handle;
+      start_us = esp_timer_get_time();
+      ESP_LOGI("ota", "begin: %lu bytes, window %u", image_size, buffer[5]);
+      return 0;
+    }
+    case Command::end: {
+      Hash expected;
+      if (len != 1 + expected.size()) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+      }
+      if (conn_handle != transfer_conn_handle) {
+        return BLE_ATT_ERR_INSUFFICIENT_AUTHEN;
+      }
+      std::copy_n(buffer.begin() + 1, expected.size(), expected.begin());
+      Response const response = transfer.finish(expected);
+      transfer_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+      bool const verified = response.reply == Transfer<FlashSink>::Reply::done;
+      image_ready.store(verified, std::memory_order_release);
+      ESP_LOGI("ota", "end: %s, %lu bytes at %lu B/s", verified ? "verified" : "failed",
+               response.received, bytes_per_s());
+      notify(conn_handle, response);
+      return 0;
+    }
+    default:
+      return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+  }
+}
+
+int Updater::on_data(uint16_t conn_handle, ble_gatt_access_ctxt *ctxt) {
+  if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+    return BLE_ATT_ERR_UNLIKELY;
+  }
+
+  if (conn_handle != transfer_conn_handle) {
+    return BLE_ATT_ERR_INSUFFICIENT_AUTHEN;
+  }
+
+  uint16_t len = 0;
+  if (ble_hs_mbuf_to_flat(ctxt->om, buffer.data(), buffer.size(), &len) != 0 || len < 2) {
+    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+  }
+
+  uint16_t const sequence = buffer[0] | buffer[1] << 8;
+  auto const response = transfer.on_chunk(sequence, std::span(buffer).subspan(2, len - 2));
+  if (response) {
+    notify(conn_handle, *response);
+  }
+
+  return 0;
+}
+
+void Updater::on_disconnect(uint16_t conn_handle) {
+  if (conn_handle != transfer_conn_handle) {
+    return;
+  }
+  transfer.abort();
+  transfer_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+  ESP_LOGW("ota", "link lost, transfer aborted");
+}
+
+void Updater::notify(uint16_t conn_handle, Response const &response) {
+  uint32_t const rate = bytes_per_s();
+  std::array<uint8_t, 11> const message = {
+      static_cast<uint8_t>(response.reply),
+      static_cast<uint8_t>(response.next_sequence),
+      static_cast<uint8_t>(response.next_sequence >> 8),
+      static_cast<uint8_t>(response.received),
+      static_cast<uint8_t>(response.received >> 8),
+      static_cast<uint8_t>(response.received >> 16),
+      static_cast<uint8_t>(response.received >> 24),
+      static_cast<uint8_t>(rate),
+      static_cast<uint8_t>(rate >> 8),
+      static_cast<uint8_t>(rate >> 16),
+      static_cast<uint8_t>(rate >> 24),
+  };
+  os_mbuf *om = ble_hs_mbuf_from_flat(message.data(), message.size());
+  if (om == nullptr || ble_gatts_notify_custom(conn_handle, *notify_handle, om) != 0) {
+    ESP_LOGE("ota", "notification failed");
+  }
+}
+
+bool Updater::trusted(uint16_t conn_handle) {
+  ble_gap_conn_desc desc;
+  if (ble_gap_conn_find(conn_handle, &desc) != 0) {
+    return false;
+  }
+  return desc.sec_state.encrypted && desc.sec_state.bonded;
+}
+
+uint32_t Updater::bytes_per_s() const {
+  int64_t const elapsed_us = esp_timer_get_time() - start_us;
+  if (elapsed_us <= 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(transfer.received()) * 1000000 / elapsed_us;
+}
+
+}  // namespace ota
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""replay a recorded command sequence against the train and report command latency
+
+the script connects to the train over ble, writes the speed and position
+commands from a replay file with their original spacing, then reads the
+latency characteristic. with --baseline the result is compared against a
+previous run and the script fails if a percentile regressed.
+
+replay file: one command per line, "<delay_ms> speed <m/s>" or
+"<delay_ms> position <m>". empty lines and lines starting with # are ignored.
+
+latency histograms accumulate since boot, reset the train before a run.
+
+requires bleak (pip install bleak)
+"""
+
+import argparse
+import asyncio
+import json
+import struct
+import sys
+
+from bleak import BleakClient, BleakScanner
+
+POSITION_UUID = "00001525-1212-efde-1523-785feabcd202"
+SPEED_UUID = "00001525-1212-efde-1523-785feabcd203"
+LATENCY_UUID = "00001525-1212-efde-1523-785feabcd204"
+
+COMMAND_UUIDS = {"speed": SPEED_UUID, "position": POSITION_UUID}
+SEGMENTS = ("access_to_handoff", "handoff_to_applied", "total")
+FIELDS = ("count", "p50_us", "p99_us", "max_us")
+
+
+def read_replay(path):
+    commands = []
+    with open(path) as replay:
+        for line in replay:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            delay_ms, kind, value = line.split()
+            if kind not in COMMAND_UUIDS:
+                raise ValueError(f"unknown command {kind}")
+            commands.append((int(delay_ms), kind, float(value)))
+    return commands
+
+
+def decode_latency(data):
+    values = struct.unpack("<12I", data)
+    return {
+        segment: dict(zip(FIELDS, values[4 * i : 4 * i + 4]))
+        for i, segment in enumerate(SEGMENTS)
+    }
+
+
+def regressions(result, baseline, tolerance):
+    found = []
+    for segment in SEGMENTS:
+        for field in ("p50_us", "p99_us"):
+            limit = baseline[segment][field] * (1 + tolerance)
+            if result[segment][field] > limit:
+                found.append(
+                    f"{segment} {field}: {result[segment][field]} > {baseline[segment][field]}"
+                )
+    return found
+
+
+async def replay(device_name, commands):
+    device = await BleakScanner.find_device_by_name(device_name)
+    if device is None:
+        raise RuntimeError(f"device {device_name} not found")
+    async with BleakClient(device) as client:
+        for delay_ms, kind, value in commands:
+            await asyncio.sleep(delay_ms / 1000)
+            await client.write_gatt_char(
+                COMMAND_UUIDS[kind], struct.pack("<f", value), response=True
+            )
+        return decode_latency(await client.read_gatt_char(LATENCY_UUID))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("replay", help="replay file with commands")
+    parser.add_argument("--device", default="henri-lok", help="advertized device name")
+    parser.add_argument("--baseline", help="json result of a previous run to compare with")
+    parser.add_argument("--save", help="store result as json for later comparison")
+    parser.add_argument(
+        "--tolerance",
+        type=float,
+        default=0.3,
+        # percentiles are bucket bounds 2^(1/4) apart, one bucket of jitter must pass
+        help="allowed relative percentile increase",
+    )
+    args = parser.parse_args()
+
+    result = asyncio.run(replay(args.device, read_replay(args.replay)))
+
+    for segment in SEGMENTS:
+        stats = result[segment]
+        print(
+            f"{segment:>20}: n={stats['count']} p50={stats['p50_us']}us "
+            f"p99={stats['p99_us']}us max={stats['max_us']}us"
+        )
+
+    if args.save:
+        with open(args.save, "w") as out:
+            json.dump(result, out, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as baseline:
+            found = regressions(result, json.load(baseline), args.tolerance)
+        for regression in found:
+            print(f"regression: {regression}")
+        if found:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()